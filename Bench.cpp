@@ -0,0 +1,685 @@
+/**
+ * Benchmarks of the battle engine
+ *
+ * Build with "make bench" (optimised) and run ./bench [result.json]
+ * Every benchmark reports ns/op and heap allocations/op, the results are also
+ * written as JSON (bench.json by default) for regression tracking.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "sources/Team.hpp"
+#include "sources/ScenarioGenerator.hpp"
+#include "sources/BattleLog.hpp"
+#include "sources/ScenarioFile.hpp"
+#include "sources/FreeForAll.hpp"
+#include "sources/SoABattle.hpp"
+#include "sources/CompactUnit.hpp"
+#include "sources/BattleCounters.hpp"
+#include "sources/Trace.hpp"
+
+using namespace ariel;
+
+namespace
+{
+    atomic<size_t> allocations{0};
+}
+
+// Count every heap allocation of the program
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, memory_order_relaxed);
+    void *memory = malloc(size == 0 ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+namespace
+{
+    using Clock = chrono::steady_clock;
+
+    // Keep the compiler from removing the measured work
+    volatile double sink = 0;
+
+    // Each benchmark repeats its measured part until it ran for this long
+    const double MIN_SECONDS = 0.2;
+
+    const unsigned int SIZES[] = {10, 1000, 100000};
+
+    struct Result
+    {
+        string name;
+        unsigned int size;
+        size_t operations;
+        double nanosecondsPerOperation;
+        double allocationsPerOperation;
+    };
+
+    vector<Result> results;
+
+    // Accumulates the time and allocations of the measured parts of a benchmark
+    class Measurement
+    {
+    public:
+        void start()
+        {
+            startAllocations = allocations.load(memory_order_relaxed);
+            startTime = Clock::now();
+        }
+
+        void stop(size_t operations)
+        {
+            Clock::time_point end = Clock::now();
+            measuredAllocations += allocations.load(memory_order_relaxed) - startAllocations;
+            seconds += chrono::duration<double>(end - startTime).count();
+            this->operations += operations;
+        }
+
+        bool done() const
+        {
+            return seconds >= MIN_SECONDS;
+        }
+
+        void report(const string &name, unsigned int size) const
+        {
+            double count = static_cast<double>(operations == 0 ? 1 : operations);
+            Result result{name, size, operations, seconds * 1e9 / count, static_cast<double>(measuredAllocations) / count};
+            cout << setw(28) << left << name << right << setw(8) << size
+                 << fixed << setprecision(1) << setw(14) << result.nanosecondsPerOperation << " ns/op"
+                 << setprecision(2) << setw(10) << result.allocationsPerOperation << " allocs/op"
+                 << defaultfloat << setw(12) << operations << " ops" << endl;
+            results.push_back(result);
+        }
+
+    private:
+        Clock::time_point startTime;
+        size_t startAllocations = 0;
+        size_t measuredAllocations = 0;
+        size_t operations = 0;
+        double seconds = 0;
+    };
+
+    unique_ptr<Team> makeTeam(int strategy, unsigned int size, ScenarioGenerator &generator)
+    {
+        unique_ptr<Team> team;
+        switch (strategy)
+        {
+        case 0:
+            team = make_unique<Team>(generator.character(), size);
+            break;
+        case 1:
+            team = make_unique<Team2>(generator.character(), size);
+            break;
+        default:
+            team = make_unique<SmartTeam>(generator.character(), size);
+            break;
+        }
+        generator.fill(*team, size - 1);
+        return team;
+    }
+
+    vector<Point> randomPoints(size_t count, ScenarioGenerator &generator)
+    {
+        vector<Point> points;
+        for (size_t i = 0; i < count; i++)
+        {
+            points.push_back(generator.location());
+        }
+        return points;
+    }
+
+    void benchmarkDistance()
+    {
+        ScenarioGenerator generator(1);
+        vector<Point> points = randomPoints(1024, generator);
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            measurement.start();
+            double total = 0;
+            for (size_t i = 0; i + 1 < points.size(); i++)
+            {
+                total += points[i].distance(points[i + 1]);
+            }
+            sink = sink + total;
+            measurement.stop(points.size() - 1);
+        }
+        measurement.report("Point::distance", 1);
+    }
+
+    void benchmarkMoveTowards()
+    {
+        ScenarioGenerator generator(2);
+        vector<Point> points = randomPoints(1024, generator);
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            measurement.start();
+            double total = 0;
+            for (size_t i = 0; i + 1 < points.size(); i++)
+            {
+                total += Point::moveTowards(points[i], points[i + 1], 10).whatX();
+            }
+            sink = sink + total;
+            measurement.stop(points.size() - 1);
+        }
+        measurement.report("Point::moveTowards", 1);
+    }
+
+    // The same moves as benchmarkMoveTowards in a single batched call
+    void benchmarkMoveTowardsBatch()
+    {
+        ScenarioGenerator generator(2);
+        vector<Point> points = randomPoints(1024, generator);
+        vector<double> xs, ys, targetXs, targetYs;
+        for (size_t i = 0; i + 1 < points.size(); i++)
+        {
+            targetXs.push_back(points[i + 1].whatX());
+            targetYs.push_back(points[i + 1].whatY());
+        }
+        vector<double> speeds(targetXs.size(), 10);
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            xs.clear();
+            ys.clear();
+            for (size_t i = 0; i + 1 < points.size(); i++)
+            {
+                xs.push_back(points[i].whatX());
+                ys.push_back(points[i].whatY());
+            }
+            measurement.start();
+            Point::moveTowards(xs.data(), ys.data(), targetXs.data(), targetYs.data(), speeds.data(), xs.size());
+            sink = sink + xs[0];
+            measurement.stop(xs.size());
+        }
+        measurement.report("Point::moveTowards batch", 1);
+    }
+
+    void benchmarkCloseCharacter(unsigned int size, DistanceMode mode, const string &name)
+    {
+        ScenarioGenerator generator(3);
+        unique_ptr<Team> team = makeTeam(0, size, generator);
+        unique_ptr<Team> origins = makeTeam(0, 100, generator);
+        team->setDistanceMode(mode);
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            measurement.start();
+            for (Character *origin : origins->characters)
+            {
+                sink = sink + team->CloseCharacter(origin, team.get())->whatHealth();
+            }
+            measurement.stop(origins->characters.size());
+        }
+        measurement.report(name, size);
+    }
+
+    void benchmarkAttack(int strategy, const string &name, unsigned int size)
+    {
+        ScenarioGenerator generator(4);
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            unique_ptr<Team> attackers = makeTeam(strategy, size, generator);
+            unique_ptr<Team> defenders = makeTeam(0, size, generator);
+            measurement.start();
+            attackers->attack(defenders.get());
+            measurement.stop(1);
+        }
+        measurement.report(name, size);
+    }
+
+    // Team::attack while recording trace scopes, for the cost of tracing when it is on
+    void benchmarkTracedAttack(unsigned int size)
+    {
+        startTracing();
+        benchmarkAttack(0, "Team::attack traced", size);
+        stopTracing();
+        clearTrace();
+    }
+
+    void benchmarkStillAlive(unsigned int size)
+    {
+        ScenarioGenerator generator(5);
+        unique_ptr<Team> team = makeTeam(1, size, generator);
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            measurement.start();
+            int total = 0;
+            for (int i = 0; i < 100000; i++)
+            {
+                total += team->stillAlive();
+            }
+            sink = sink + total;
+            measurement.stop(100000);
+        }
+        measurement.report("Team::stillAlive", size);
+    }
+
+    // Formatting of a whole team into a buffer that is reused between rounds
+    void benchmarkPrint(unsigned int size)
+    {
+        ScenarioGenerator generator(9);
+        unique_ptr<Team> team = makeTeam(0, size, generator);
+        string buffer;
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            measurement.start();
+            buffer.clear();
+            team->printTo(buffer);
+            sink = sink + static_cast<double>(buffer.size());
+            measurement.stop(1);
+        }
+        measurement.report("Team::printTo", size);
+    }
+
+    // Team against Team2 until one of them is wiped out, one operation per battle
+    void benchmarkBattle(unsigned int size)
+    {
+        ScenarioGenerator generator(6);
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            unique_ptr<Team> first = makeTeam(0, size, generator);
+            unique_ptr<Team> second = makeTeam(1, size, generator);
+            measurement.start();
+            while (first->stillAlive() > 0 && second->stillAlive() > 0)
+            {
+                first->attack(second.get());
+                if (second->stillAlive() > 0)
+                {
+                    second->attack(first.get());
+                }
+            }
+            measurement.stop(1);
+        }
+        measurement.report("battle Team vs Team2", size);
+    }
+
+    // Battle of FREE_FOR_ALL_TEAMS teams of every strategy sharing the units of the size
+    void benchmarkFreeForAll(unsigned int size)
+    {
+        const unsigned int FREE_FOR_ALL_TEAMS = 24;
+        ScenarioGenerator generator(8);
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            vector<unique_ptr<Team>> teams;
+            FreeForAll battle;
+            for (unsigned int team = 0; team < FREE_FOR_ALL_TEAMS; team++)
+            {
+                teams.push_back(makeTeam(static_cast<int>(team % 3), size / FREE_FOR_ALL_TEAMS, generator));
+                battle.join(teams.back().get());
+            }
+            measurement.start();
+            battle.fight();
+            measurement.stop(1);
+        }
+        measurement.report("free-for-all battle", size);
+    }
+
+    // Simultaneous rounds of Team vs Team2, on the calling thread or spread over every core
+    void benchmarkSimultaneousRound(unsigned int size, bool parallel)
+    {
+        ScenarioGenerator generator(6);
+        WorkStealingPool pool;
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            unique_ptr<Team> first = makeTeam(0, size, generator);
+            unique_ptr<Team> second = makeTeam(1, size, generator);
+            SoABattle battle(first.get(), second.get());
+            while (!measurement.done() && battle.stillAlive(0) > 0 && battle.stillAlive(1) > 0)
+            {
+                measurement.start();
+                battle.simultaneousRound(parallel ? &pool : nullptr);
+                measurement.stop(1);
+            }
+        }
+        measurement.report(parallel ? "simultaneous round pool" : "simultaneous round", size);
+    }
+
+    // Team vs Team2 in the structure-of-arrays engine, with the sequential or the parallel attack
+    void benchmarkSoABattle(unsigned int size, bool parallel)
+    {
+        ScenarioGenerator generator(6);
+        WorkStealingPool pool;
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            unique_ptr<Team> first = makeTeam(0, size, generator);
+            unique_ptr<Team> second = makeTeam(1, size, generator);
+            SoABattle battle(first.get(), second.get());
+            measurement.start();
+            for (unsigned int side = 0; battle.stillAlive(0) > 0 && battle.stillAlive(1) > 0; side = 1 - side)
+            {
+                if (parallel)
+                {
+                    battle.parallelAttack(side, pool);
+                }
+                else
+                {
+                    battle.attack(side);
+                }
+            }
+            measurement.stop(1);
+        }
+        measurement.report(parallel ? "SoA battle parallel attack" : "SoA battle", size);
+    }
+
+    // Stream that throws away what is written to it
+    class NullBuffer : public streambuf
+    {
+    protected:
+        streamsize xsputn(const char *, streamsize count) override
+        {
+            return count;
+        }
+
+        int overflow(int character) override
+        {
+            return character;
+        }
+    };
+
+    // Same battle as benchmarkBattle with every action recorded in a binary log
+    void benchmarkLoggedBattle(unsigned int size)
+    {
+        ScenarioGenerator generator(6);
+        NullBuffer discard;
+        ostream out(&discard);
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            // A log holds at most 256 teams, so every battle gets its own
+            BattleLog log(out);
+            unique_ptr<Team> first = makeTeam(0, size, generator);
+            unique_ptr<Team> second = makeTeam(1, size, generator);
+            measurement.start();
+            first->setLog(&log);
+            second->setLog(&log);
+            while (first->stillAlive() > 0 && second->stillAlive() > 0)
+            {
+                first->attack(second.get());
+                if (second->stillAlive() > 0)
+                {
+                    second->attack(first.get());
+                }
+            }
+            log.flush();
+            measurement.stop(1);
+            first->setLog(nullptr);
+            second->setLog(nullptr);
+        }
+        measurement.report("battle logged", size);
+    }
+
+    const unsigned int SWEEP_UNITS = 1000000;
+
+    // Every ninja of a million units moves towards a target, then the units next to it are counted:
+    // once over the characters themselves, once over their 16 byte compact units
+    void benchmarkUnitSweep(bool compact)
+    {
+        ScenarioGenerator generator(8);
+        vector<unique_ptr<Character>> characters;
+        vector<CompactUnit> units;
+        for (size_t i = 0; i < SWEEP_UNITS; i++)
+        {
+            unique_ptr<Character> character(generator.character());
+            if (compact)
+            {
+                units.push_back(makeCompactUnit(*character, 0));
+            }
+            else
+            {
+                characters.push_back(move(character));
+            }
+        }
+        Cowboy target("Target", Point(0, 0));
+        PointF targetLocation(target.getLocation());
+        Measurement measurement;
+        while (!measurement.done())
+        {
+            measurement.start();
+            size_t arrived = 0;
+            if (compact)
+            {
+                for (CompactUnit &unit : units)
+                {
+                    if (unit.speed > 0)
+                    {
+                        unit.setLocation(PointF::moveTowards(unit.location(), targetLocation, unit.speed));
+                    }
+                    if (unit.location().withinUnitDistance(targetLocation))
+                    {
+                        arrived++;
+                    }
+                }
+            }
+            else
+            {
+                for (unique_ptr<Character> &character : characters)
+                {
+                    if (character->isNinja())
+                    {
+                        static_cast<Ninja *>(character.get())->move(&target);
+                    }
+                    if (character->getLocation().withinUnitDistance(target.getLocation()))
+                    {
+                        arrived++;
+                    }
+                }
+            }
+            sink = sink + static_cast<double>(arrived);
+            measurement.stop(SWEEP_UNITS);
+        }
+        measurement.report(compact ? "Unit sweep compact" : "Unit sweep characters", SWEEP_UNITS);
+    }
+
+    // Dispatch of the attack loops with RTTI (before the kind tag) and with the kind tag
+    void benchmarkDispatch(unsigned int size)
+    {
+        ScenarioGenerator generator(7);
+        vector<Character *> army = generator.characters(size);
+        Measurement rtti;
+        while (!rtti.done())
+        {
+            rtti.start();
+            long total = 0;
+            for (Character *character : army)
+            {
+                Cowboy *cowboy = dynamic_cast<Cowboy *>(character);
+                Ninja *ninja = dynamic_cast<Ninja *>(character);
+                total += cowboy != nullptr && cowboy->hasboolets() ? 1 : ninja != nullptr ? 2 : 0;
+            }
+            sink = sink + static_cast<double>(total);
+            rtti.stop(army.size());
+        }
+        rtti.report("dispatch dynamic_cast", size);
+
+        Measurement tag;
+        while (!tag.done())
+        {
+            tag.start();
+            long total = 0;
+            for (Character *character : army)
+            {
+                total += character->isCowboy() && static_cast<Cowboy *>(character)->hasboolets() ? 1 : character->isNinja() ? 2 : 0;
+            }
+            sink = sink + static_cast<double>(total);
+            tag.stop(army.size());
+        }
+        tag.report("dispatch kind tag", size);
+
+        for (Character *character : army)
+        {
+            delete character;
+        }
+    }
+
+    // Build and tear down teams whose members come from new or from the arena of the team
+    void benchmarkTeamLifetime(unsigned int size)
+    {
+        ScenarioGenerator generator(8);
+        Measurement withNew;
+        while (!withNew.done())
+        {
+            withNew.start();
+            {
+                Team team(generator.character(), size);
+                for (unsigned int member = 1; member < size; member++)
+                {
+                    team.add(generator.character());
+                }
+            }
+            withNew.stop(size);
+        }
+        withNew.report("team lifetime new", size);
+
+        Measurement withArena;
+        while (!withArena.done())
+        {
+            withArena.start();
+            {
+                Team team(generator.character(), size);
+                generator.fill(team, size - 1);
+            }
+            withArena.stop(size);
+        }
+        withArena.report("team lifetime emplace", size);
+
+        const string path = "bench_scenario.ncsc";
+        vector<ScenarioRecord> records;
+        for (unsigned int member = 0; member < size; member++)
+        {
+            unique_ptr<Character> character(generator.character());
+            records.push_back(makeRecord(*character, 0));
+        }
+        saveScenario(path, records);
+        Measurement fromFile;
+        while (!fromFile.done())
+        {
+            fromFile.start();
+            {
+                MappedScenario scenario(path);
+                unique_ptr<Team> team = scenario.team(0, Strategy::Team);
+            }
+            fromFile.stop(size);
+        }
+        fromFile.report("team lifetime scenario file", size);
+        remove(path.c_str());
+    }
+
+    void writeJson(const string &path)
+    {
+        ofstream out(path);
+        if (!out)
+        {
+            throw runtime_error("Can't write " + path);
+        }
+        out << "{\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result &result = results[i];
+            out << "    {\"name\": \"" << result.name << "\", \"size\": " << result.size
+                << ", \"operations\": " << result.operations
+                << ", \"ns_per_op\": " << setprecision(6) << result.nanosecondsPerOperation
+                << ", \"allocs_per_op\": " << result.allocationsPerOperation << "}"
+                << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    string path = argc > 1 ? argv[1] : "bench.json";
+    try
+    {
+        benchmarkDistance();
+        benchmarkMoveTowards();
+        benchmarkMoveTowardsBatch();
+        benchmarkUnitSweep(false);
+        benchmarkUnitSweep(true);
+        for (unsigned int size : SIZES)
+        {
+            benchmarkCloseCharacter(size, DistanceMode::Truncated, "Team::CloseCharacter");
+            benchmarkCloseCharacter(size, DistanceMode::Squared, "CloseCharacter squared");
+            benchmarkAttack(0, "Team::attack", size);
+            benchmarkTracedAttack(size);
+            benchmarkAttack(1, "Team2::attack", size);
+            benchmarkAttack(2, "SmartTeam::attack", size);
+            benchmarkStillAlive(size);
+            benchmarkPrint(size);
+            benchmarkBattle(size);
+            benchmarkSimultaneousRound(size, false);
+            benchmarkSimultaneousRound(size, true);
+            if (size >= 1000)
+            {
+                benchmarkFreeForAll(size);
+            }
+            if (size <= 1000)
+            {
+                benchmarkLoggedBattle(size);
+                benchmarkSoABattle(size, false);
+                benchmarkSoABattle(size, true);
+            }
+            benchmarkDispatch(size);
+            benchmarkTeamLifetime(size);
+        }
+        writeJson(path);
+        if (countersEnabled())
+        {
+            cout << "\nEvents of all the benchmarks:\n"
+                 << counterSnapshot().report();
+        }
+    }
+    catch (const exception &error)
+    {
+        cerr << "Error: " << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * Command line runner of battle tournaments between Team, Team2 and SmartTeam
+ *
+ * usage: ./tournament [--battles N] [--size N] [--seed N] [--threads N] [--rounds N]
+ */
+
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+using namespace std;
+
+#include "sources/Tournament.hpp"
+
+using namespace ariel;
+
+namespace
+{
+    unsigned long long parseNumber(const char *option, const char *value)
+    {
+        if (value == nullptr)
+        {
+            throw invalid_argument(string("Missing value for ") + option);
+        }
+        size_t used = 0;
+        unsigned long long number = stoull(value, &used);
+        if (value[used] != '\0' || value[0] == '-')
+        {
+            throw invalid_argument(string("Invalid value for ") + option + ": " + value);
+        }
+        return number;
+    }
+
+    // Parse a value that must fit in an unsigned int (sizes and counts)
+    unsigned int parseCount(const char *option, const char *value)
+    {
+        unsigned long long number = parseNumber(option, value);
+        if (number > numeric_limits<unsigned int>::max())
+        {
+            throw invalid_argument(string("Value too large for ") + option + ": " + value);
+        }
+        return static_cast<unsigned int>(number);
+    }
+
+    TournamentConfig parseArguments(int argc, char **argv)
+    {
+        TournamentConfig config;
+        for (int i = 1; i < argc; i += 2)
+        {
+            const char *option = argv[i];
+            const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+            if (strcmp(option, "--battles") == 0)
+            {
+                config.battles = parseCount(option, value);
+            }
+            else if (strcmp(option, "--size") == 0)
+            {
+                config.teamSize = parseCount(option, value);
+            }
+            else if (strcmp(option, "--seed") == 0)
+            {
+                config.seed = parseNumber(option, value);
+            }
+            else if (strcmp(option, "--threads") == 0)
+            {
+                config.threads = parseCount(option, value);
+            }
+            else if (strcmp(option, "--rounds") == 0)
+            {
+                config.maxRounds = parseCount(option, value);
+            }
+            else
+            {
+                throw invalid_argument(string("Unknown option ") + option);
+            }
+        }
+        return config;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        TournamentReport report = runTournament(parseArguments(argc, argv));
+        printReport(cout, report);
+    }
+    catch (const exception &error)
+    {
+        cerr << "Error: " << error.what() << endl;
+        cerr << "usage: " << argv[0] << " [--battles N] [--size N] [--seed N] [--threads N] [--rounds N]" << endl;
+        return 1;
+    }
+    return 0;
+}
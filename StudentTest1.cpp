@@ -6,20 +6,34 @@
 #include "sources/Cowboy.hpp"
 #include "sources/Team.hpp"
 #include "sources/Team2.hpp"
-#include <random>
-#include <chrono>
+#include "sources/SoABattle.hpp"
+#include "sources/NearestKernel.hpp"
+#include "sources/Tournament.hpp"
+#include "sources/ScenarioGenerator.hpp"
+#include "sources/BattleLog.hpp"
+#include "sources/ScenarioFile.hpp"
+#include "sources/FreeForAll.hpp"
+#include "sources/CompactUnit.hpp"
+#include "sources/UnitTraits.hpp"
+#include "sources/BattleCounters.hpp"
+#include "sources/Trace.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include "sources/WorkStealingPool.hpp"
 #include <iostream>
 
 using namespace ariel;
 using namespace std;
 //<--------------------Helper Functions-------------------->
-// https://www.geeksforgeeks.org/generate-a-random-float-number-in-cpp/
+// Fixed seed, so that every run places the characters the same way
+Xoshiro256 random_engine{2023};
+
 double random_float(double min = -100, double max = 100)
 {
-    std::default_random_engine generator(static_cast<unsigned long>(std::chrono::system_clock::now().time_since_epoch().count()));
-    std::uniform_real_distribution<double> distribution(min, max);
-
-    return distribution(generator);
+    return random_engine.uniform(min, max);
 }
 
 auto create_yninja = [](double x = random_float(), double y = random_float())
@@ -112,6 +126,61 @@ TEST_SUITE("Point class tests")
         // There is no such a thing as negative distance
         CHECK_THROWS_AS(Point::moveTowards(p1, p2, -1), std::invalid_argument);
     }
+
+    TEST_CASE("The fused and batched moveTowards match the step by step computation")
+    {
+        // The original computation: one sqrt for the range check and one per coordinate
+        auto reference = [](const Point &from, const Point &to, double dist)
+        {
+            if (from.distance(to) <= dist)
+            {
+                return to;
+            }
+            double new_x = from.whatX() + (to.whatX() - from.whatX()) * (dist / from.distance(to));
+            double new_y = from.whatY() + (to.whatY() - from.whatY()) * (dist / from.distance(to));
+            return Point(new_x, new_y);
+        };
+
+        vector<double> xs, ys, targetXs, targetYs, dists;
+        vector<Point> expected;
+        for (int i = 0; i < 500; i++)
+        {
+            Point from(random_float(), random_float());
+            Point to(random_float(), random_float());
+            double dist = random_float(0, 300);
+            expected.push_back(reference(from, to, dist));
+            CHECK(Point::moveTowards(from, to, dist).compare(expected.back()));
+            xs.push_back(from.whatX());
+            ys.push_back(from.whatY());
+            targetXs.push_back(to.whatX());
+            targetYs.push_back(to.whatY());
+            dists.push_back(dist);
+        }
+
+        Point::moveTowards(xs.data(), ys.data(), targetXs.data(), targetYs.data(), dists.data(), xs.size());
+        for (size_t i = 0; i < xs.size(); i++)
+        {
+            CHECK(Point(xs[i], ys[i]).compare(expected[i]));
+        }
+
+        // Nothing moves when one of the distances is negative
+        vector<double> before = xs;
+        dists[250] = -1;
+        CHECK_THROWS_AS(Point::moveTowards(xs.data(), ys.data(), targetXs.data(), targetYs.data(), dists.data(), xs.size()), std::invalid_argument);
+        CHECK(xs == before);
+    }
+
+    TEST_CASE("nearestIndex picks the first closest point on every instruction set")
+    {
+        // 1.5 and 1.9 truncate to the same distance, the first of them must win
+        std::vector<double> xs{9, 5, 1.9, 7, 1.5, 3, 8, 1.9, 6};
+        std::vector<double> ys(xs.size(), 0);
+        for (auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2})
+        {
+            CHECK_EQ(nearestIndex(xs.data(), ys.data(), xs.size(), 0, 0, level), 2);
+            CHECK_EQ(nearestIndex(xs.data(), ys.data(), 0, 0, 0, level), 0);
+        }
+    }
 }
 
 TEST_SUITE("Classes initialization tests and Team modification( add(),stillAlive() )")
@@ -158,6 +227,87 @@ TEST_SUITE("Classes initialization tests and Team modification( add(),stillAlive
         CHECK(trained_ninja.isAlive());
     }
 
+    TEST_CASE("Every character knows its kind")
+    {
+        Cowboy cowboy{"Bob", Point{2, 3}};
+        YoungNinja young{"Bob", Point{2, 3}};
+        TrainedNinja trained{"Bob", Point{2, 3}};
+        OldNinja old{"Bob", Point{2, 3}};
+        Character plain{"Bob", 10, Point{2, 3}};
+
+        CHECK_EQ(cowboy.whatKind(), CharacterKind::Cowboy);
+        CHECK_EQ(young.whatKind(), CharacterKind::YoungNinja);
+        CHECK_EQ(trained.whatKind(), CharacterKind::TrainedNinja);
+        CHECK_EQ(old.whatKind(), CharacterKind::OldNinja);
+        CHECK_EQ(Ninja{}.whatKind(), CharacterKind::Ninja);
+        CHECK_EQ(YoungNinja{}.whatKind(), CharacterKind::YoungNinja);
+
+        CHECK(cowboy.isCowboy());
+        CHECK_FALSE(cowboy.isNinja());
+        CHECK(old.isNinja());
+        CHECK_FALSE(old.isCowboy());
+        CHECK_FALSE(plain.isCowboy());
+        CHECK_FALSE(plain.isNinja());
+    }
+
+    TEST_CASE("Seeded scenarios are reproducible")
+    {
+        ScenarioGenerator first{99};
+        ScenarioGenerator second{99};
+        for (int i = 0; i < 10; i++)
+        {
+            Point location = first.location();
+            CHECK_EQ(location.distance(second.location()), 0);
+            CHECK(location.whatX() >= -100);
+            CHECK(location.whatX() < 100);
+            CHECK_EQ(first.kind(), second.kind());
+        }
+        CHECK_NE(Xoshiro256{1}.next(), Xoshiro256{2}.next());
+
+        KindMix onlyOldNinjas{0, 0, 0, 1};
+        ScenarioGenerator ninjas{5, 0, 1, onlyOldNinjas};
+        Team team{ninjas.character(), 100};
+        ninjas.fill(team, 99);
+        CHECK_EQ(team.stillAlive(), 100);
+        CHECK_EQ(team.cowboyCount, 0);
+        CHECK_EQ(team.characters[0]->whatKind(), CharacterKind::OldNinja);
+
+        CHECK_THROWS_AS(ScenarioGenerator(1, 0, 0), std::invalid_argument);
+        CHECK_THROWS_AS(ScenarioGenerator(1, 0, 1, KindMix{0, 0, 0, 0}), std::invalid_argument);
+    }
+
+    TEST_CASE("Printing into a reusable buffer")
+    {
+        Point point{1.5, -2.0625};
+        string buffer;
+        point.printTo(buffer, false);
+        CHECK_EQ(buffer, "(1.500, -2.062)");
+        buffer.clear();
+        point.printTo(buffer);
+        CHECK_EQ(buffer, point.print());
+
+        auto cowboy = create_cowboy(1, 2);
+        Team team{cowboy};
+        team.add(create_oninja(3, 4));
+        Team2 team2{create_tninja(5, 6)};
+        buffer.clear();
+        team.printTo(buffer);
+        CHECK_NE(buffer.find("\033["), string::npos);
+        CHECK_NE(buffer.find("LEADER"), string::npos);
+
+        buffer.clear();
+        team.printTo(buffer, false);
+        CHECK_EQ(buffer.find("\033["), string::npos);
+        CHECK_NE(buffer.find("(1.000, 2.000)"), string::npos);
+
+        buffer.clear();
+        team2.printTo(buffer, false);
+        CHECK_EQ(buffer.find("\033["), string::npos);
+        CHECK_NE(buffer.find("(5.000, 6.000)"), string::npos);
+        CHECK_NE(buffer.find("(Leader)"), string::npos);
+        CHECK_NE(cowboy->print().find("Ammo:     6"), string::npos);
+    }
+
     TEST_CASE("Team initialization")
     {
         auto cowboy = create_cowboy(2, 3);
@@ -194,6 +344,79 @@ TEST_SUITE("Classes initialization tests and Team modification( add(),stillAlive
         delete over;
     }
 
+    TEST_CASE("Teams with a custom capacity")
+    {
+        const unsigned int capacity = 1000;
+        auto captain = create_cowboy();
+        Team team{captain, capacity};
+        Team2 team2{create_yninja(), capacity};
+        for (unsigned int i = 1; i < capacity; i++)
+        {
+            team.add(i % 2 ? static_cast<Character *>(create_oninja()) : create_cowboy());
+            team2.add(create_cowboy());
+        }
+        CHECK_EQ(team.stillAlive(), capacity);
+        CHECK_EQ(team2.stillAlive(), capacity);
+        CHECK_EQ(team.cowboyCount, capacity / 2);
+        CHECK_EQ(team.characters[0], captain);
+
+        auto over = create_cowboy();
+        CHECK_THROWS_AS(team.add(over), std::runtime_error);
+        CHECK_THROWS_AS(team2.add(over), std::runtime_error);
+        delete over;
+
+        auto unused = create_cowboy();
+        CHECK_THROWS_AS(Team(unused, 0), std::invalid_argument);
+        delete unused;
+    }
+
+    TEST_CASE("Members built in the memory of the team")
+    {
+        Team team{create_cowboy(0, 0), 3};
+        Team2 team2{create_oninja(5, 5)};
+
+        auto cowboy = team.emplace<Cowboy>("Arena", Point{1, 1});
+        auto ninja = team2.emplace<TrainedNinja>("Arena", Point{6, 6});
+        CHECK_EQ(team.stillAlive(), 2);
+        CHECK_EQ(team2.stillAlive(), 2);
+        CHECK(cowboy->isInTeam());
+        CHECK_EQ(ninja->whatHealth(), 120);
+        CHECK_EQ(team.characters[1], cowboy);
+
+        // Members from new and from the arena can be mixed
+        team.add(create_yninja(2, 2));
+        CHECK_THROWS_AS(team.emplace<OldNinja>("Over", Point{3, 3}), std::runtime_error);
+
+        while (team.stillAlive() > 0 && team2.stillAlive() > 0)
+        {
+            team.attack(&team2);
+            if (team2.stillAlive() > 0)
+            {
+                team2.attack(&team);
+            }
+        }
+    }
+
+    TEST_CASE("stillAlive() follows deaths outside of attack()")
+    {
+        auto captain = create_yninja();
+        auto cowboy = create_cowboy();
+        Team team{captain};
+        team.add(cowboy);
+        CHECK(team.isAliveAt(0));
+        CHECK_EQ(team.nextAlive(1), TEAM_SIZE - 1);
+
+        Cowboy shooter{"Clint", Point{0, 0}};
+        while (cowboy->isAlive())
+        {
+            shooter.reload();
+            shooter.shoot(cowboy);
+        }
+        CHECK_EQ(team.stillAlive(), 1);
+        CHECK_FALSE(team.isAliveAt(0));
+        CHECK_EQ(team.nextAlive(0), TEAM_SIZE - 1);
+    }
+
     TEST_CASE("Appointing the same captain to different teams")
     {
         auto captain = create_cowboy();
@@ -675,6 +898,130 @@ TEST_SUITE("Battle simulations")
         CHECK_NOTHROW(simulate_battle(team, team2));
     }
 
+    TEST_CASE("The closest enemy is tracked while characters move and die")
+    {
+        auto captain = create_cowboy(0, 0);
+        Team team{captain};
+
+        auto far = create_yninja(500, 500);
+        auto near = create_cowboy(40, 0);
+        auto tied = create_cowboy(0, 40);
+        Team team2{far};
+        team2.add(near);
+        team2.add(tied);
+
+        // near and tied are at the same distance, the first checked one wins
+        CHECK_EQ(team.CloseCharacter(captain, &team2), near);
+
+        far->move(captain);
+        CHECK_EQ(team.CloseCharacter(captain, &team2), near);
+        for (int i = 0; i < 60; i++)
+        {
+            far->move(captain);
+        }
+        CHECK_EQ(team.CloseCharacter(captain, &team2), far);
+
+        while (far->isAlive())
+        {
+            captain->reload();
+            captain->shoot(far);
+        }
+        CHECK_EQ(team.CloseCharacter(captain, &team2), near);
+    }
+
+    TEST_CASE("Squared distances never truncate and agree with distance()")
+    {
+        CHECK_EQ(Point(0, 0).squaredDistance(Point(3, 4)), 25);
+        for (int i = 0; i < 2000; i++)
+        {
+            // Points right around the unit circle, where the sqrt rounding matters
+            double angle = i * 0.0031;
+            double scale = 1 + (i % 9 - 4) * numeric_limits<double>::epsilon();
+            Point point(cos(angle) * scale, sin(angle) * scale);
+            CHECK_EQ(Point(0, 0).withinUnitDistance(point), Point(0, 0).distance(point) <= 1);
+        }
+        CHECK(Point(0, 0).withinUnitDistance(Point(1, 0)));
+        CHECK_FALSE(Point(0, 0).withinUnitDistance(Point(nextafter(1.0, 2.0), 0)));
+
+        auto captain = create_cowboy(0, 0);
+        Team team{captain};
+        auto first = create_cowboy(10.9, 0);
+        auto closer = create_cowboy(10.1, 0);
+        auto tied = create_cowboy(0, 10.1);
+        Team team2{first};
+        team2.add(closer);
+        team2.add(tied);
+        CHECK_EQ(captain->squaredDistance(first), doctest::Approx(118.81));
+        CHECK_THROWS_AS(captain->squaredDistance(nullptr), std::invalid_argument);
+
+        // Both are 10 away once truncated, so the first one wins in the compatibility mode
+        CHECK_EQ(team.distanceMode(), DistanceMode::Truncated);
+        CHECK_EQ(team.CloseCharacter(captain, &team2), first);
+        team.setDistanceMode(DistanceMode::Squared);
+        CHECK_EQ(team.CloseCharacter(captain, &team2), closer);
+
+        // Against a brute force search over the squared distances
+        ScenarioGenerator generator{14};
+        Team army{generator.character(), 200};
+        generator.fill(army, 199);
+        for (int i = 0; i < 50; i++)
+        {
+            Point origin = generator.location();
+            Cowboy probe{"Probe", origin};
+            Character *expected = nullptr;
+            for (Character *member : army.characters)
+            {
+                if (expected == nullptr || member->squaredDistance(&probe) < expected->squaredDistance(&probe))
+                {
+                    expected = member;
+                }
+            }
+            CHECK_EQ(team.CloseCharacter(&probe, &army), expected);
+        }
+    }
+
+    TEST_CASE("The structure-of-arrays engine fights like Team and Team2")
+    {
+        auto build = [](Team &team, Team &team2, double shift)
+        {
+            for (int i = 1; i < MAX_TEAM; i++)
+            {
+                team.add(i % 3 ? static_cast<Character *>(create_tninja(i + shift, -i)) : create_cowboy(i, i * shift));
+                team2.add(i % 2 ? static_cast<Character *>(create_oninja(-i, i - shift)) : create_cowboy(-i * shift, -i));
+            }
+        };
+        for (DistanceMode mode : {DistanceMode::Truncated, DistanceMode::Squared})
+        {
+            Team team{create_cowboy(0, 0)};
+            Team2 team2{create_yninja(20, 20)};
+            Team copy{create_cowboy(0, 0)};
+            Team2 copy2{create_yninja(20, 20)};
+            build(team, team2, 0.5);
+            build(copy, copy2, 0.5);
+            for (Team *side : {static_cast<Team *>(&team), static_cast<Team *>(&team2), static_cast<Team *>(&copy), static_cast<Team *>(&copy2)})
+            {
+                side->setDistanceMode(mode);
+            }
+
+            simulate_battle(team, team2);
+
+            SoABattle battle{&copy, &copy2};
+            for (unsigned int i = 0; battle.stillAlive(0) && battle.stillAlive(1); i++)
+            {
+                battle.attack(i % 2);
+            }
+            battle.writeBack();
+
+            CHECK_EQ(copy.stillAlive(), team.stillAlive());
+            CHECK_EQ(copy2.stillAlive(), team2.stillAlive());
+            for (unsigned int i = 0; i < TEAM_SIZE; i++)
+            {
+                CHECK_EQ(copy.characters[i]->whatHealth(), team.characters[i]->whatHealth());
+                CHECK(copy2.characters[i]->getLocation().compare(team2.characters[i]->getLocation()));
+            }
+        }
+    }
+
     TEST_CASE("Run full battles using random_char to ensure full functionality")
     {
         SUBCASE("Team vs Team")
@@ -722,4 +1069,783 @@ TEST_SUITE("Battle simulations")
             CHECK(((team.stillAlive() && !team2.stillAlive()) || (!team.stillAlive() && team2.stillAlive())));
         }
     }
+
+    TEST_CASE("SmartTeam stops attacking once the enemy team is wiped out")
+    {
+        SmartTeam team{create_cowboy(0, 0)};
+        team.add(create_cowboy(0, 1));
+        Team2 team2{create_yninja(0, 2)};
+        auto target = team2.characters[0];
+        while (target->whatHealth() > 10)
+        {
+            target->hit(10);
+        }
+
+        CHECK_NOTHROW(team.attack(&team2));
+        CHECK_EQ(team2.stillAlive(), 0);
+    }
+
+    TEST_CASE("The work-stealing pool runs every task once")
+    {
+        WorkStealingPool pool{4};
+        CHECK_EQ(pool.size(), 4);
+
+        vector<int> runs(1000, 0);
+        pool.run(runs.size(), [&runs](size_t index)
+                 { runs[index]++; });
+        CHECK_EQ(count(runs.begin(), runs.end(), 1), runs.size());
+
+        CHECK_THROWS_AS(pool.run(100, [](size_t index)
+                                 { if (index == 42) throw std::runtime_error("task failed"); }),
+                        std::runtime_error);
+        pool.run(0, [](size_t)
+                 { FAIL("no task to run"); });
+    }
+
+    TEST_CASE("Tournaments don't depend on the number of threads")
+    {
+        TournamentConfig config;
+        config.battles = 60;
+        config.seed = 7;
+        config.threads = 1;
+        TournamentReport single = runTournament(config);
+        config.threads = 3;
+        TournamentReport parallel = runTournament(config);
+
+        CHECK_EQ(parallel.threads, 3);
+        unsigned int battles = 0;
+        for (unsigned int strategy = 0; strategy < STRATEGY_COUNT; strategy++)
+        {
+            CHECK_EQ(single.records[strategy].wins, parallel.records[strategy].wins);
+            CHECK_EQ(single.records[strategy].losses, parallel.records[strategy].losses);
+            battles += single.records[strategy].battles;
+        }
+        CHECK_EQ(battles, 2 * config.battles);
+        CHECK_EQ(single.meanRounds, parallel.meanRounds);
+        for (unsigned int battle = 0; battle < config.battles; battle++)
+        {
+            CHECK_EQ(single.results[battle].rounds, parallel.results[battle].rounds);
+            CHECK_EQ(single.results[battle].winner, parallel.results[battle].winner);
+        }
+    }
+
+    TEST_CASE("A battle log replays to the final state of the teams")
+    {
+        auto check_replay = [](Team &team, Team &team2, unsigned int rounds)
+        {
+            stringstream file;
+            {
+                // A tiny ring buffer, so the writer has to catch up many times
+                BattleLog log{file, 8};
+                team.setLog(&log);
+                team2.setLog(&log);
+                for (unsigned int round = 0; round < rounds && team.stillAlive() && team2.stillAlive(); round++)
+                {
+                    team.attack(&team2);
+                    if (team2.stillAlive())
+                    {
+                        team2.attack(&team);
+                    }
+                }
+                log.flush();
+                CHECK_EQ(file.str().size(), 8 + log.recorded() * sizeof(BattleEvent));
+                team.setLog(nullptr);
+                team2.setLog(nullptr);
+            }
+
+            BattleLogReader reader{file};
+            BattleReplay replay;
+            CHECK(replay.replay(reader) > 0);
+            Team *teams[] = {&team, &team2};
+            for (uint8_t id = 0; id < 2; id++)
+            {
+                const vector<ReplayUnit> &units = replay.team(id);
+                for (unsigned int slot = 0; slot < units.size(); slot++)
+                {
+                    Character *member = teams[id]->characters[slot];
+                    CHECK_EQ(units[slot].present, member != nullptr);
+                    if (member != nullptr)
+                    {
+                        CHECK_EQ(units[slot].health, member->whatHealth());
+                        CHECK_EQ(units[slot].location.distance(member->getLocation()), 0);
+                        CHECK_EQ(units[slot].kind, static_cast<uint8_t>(member->whatKind()));
+                        if (member->isCowboy())
+                        {
+                            CHECK_EQ(units[slot].bullets, static_cast<Cowboy *>(member)->whatBullets());
+                        }
+                    }
+                }
+            }
+        };
+
+        ScenarioGenerator generator{12};
+        Team team{generator.character()};
+        generator.fill(team, 9);
+        SmartTeam smart{generator.character()};
+        generator.fill(smart, 9);
+        check_replay(team, smart, 1000);
+
+        Team2 team2{generator.character()};
+        generator.fill(team2, 9);
+        Team other{generator.character()};
+        generator.fill(other, 9);
+        check_replay(team2, other, 3);
+
+        stringstream garbage{"not a log at all"};
+        CHECK_THROWS_AS(BattleLogReader{garbage}, std::runtime_error);
+    }
+
+    TEST_CASE("Scenario files load the same teams that were saved")
+    {
+        const string path = "test_scenario.ncsc";
+        ScenarioGenerator generator{13};
+        vector<ScenarioRecord> records;
+        vector<Character *> army = generator.characters(30);
+        army[4]->hit(35);
+        army[7]->hit(500);
+        for (size_t i = 0; i < army.size(); i++)
+        {
+            // Interleaved teams, saved grouped by team
+            records.push_back(makeRecord(*army[i], static_cast<uint8_t>(i % 3)));
+        }
+        saveScenario(path, records);
+
+        MappedScenario scenario{path};
+        CHECK_EQ(scenario.size(), 30);
+        CHECK_EQ(scenario.teamCount(), 3);
+        Strategy strategies[] = {Strategy::Team, Strategy::Team2, Strategy::SmartTeam};
+        for (unsigned int index = 0; index < 3; index++)
+        {
+            CHECK_EQ(scenario.teamSize(index), 10);
+            unique_ptr<Team> loaded = scenario.team(index, strategies[index]);
+            unique_ptr<Team> added = makeTeam(strategies[index], army[index], 10);
+            for (size_t i = index + 3; i < army.size(); i += 3)
+            {
+                added->add(army[i]);
+            }
+            CHECK_EQ(loaded->count, 10);
+            CHECK_EQ(loaded->stillAlive(), added->stillAlive());
+            CHECK_EQ(loaded->leader->getLocation().distance(added->leader->getLocation()), 0);
+            for (unsigned int slot = 0; slot < 10; slot++)
+            {
+                Character *member = loaded->characters[slot];
+                Character *expected = added->characters[slot];
+                CHECK_EQ(member->whatKind(), expected->whatKind());
+                CHECK_EQ(member->whatHealth(), expected->whatHealth());
+                CHECK_EQ(member->getLocation().distance(expected->getLocation()), 0);
+                CHECK_EQ(member->isLeader(), expected->isLeader());
+            }
+            CHECK_THROWS_AS(loaded->load(&*scenario.begin(), 1), std::runtime_error);
+        }
+        CHECK_THROWS_AS(scenario.teamSize(3), std::out_of_range);
+
+        // A unit with more health than its kind can have is rejected when the file is opened
+        records[0].health = 1000;
+        saveScenario(path, records);
+        CHECK_THROWS_AS(MappedScenario{path}, std::runtime_error);
+        records[0].health = 10;
+        records[1].kind = static_cast<uint8_t>(CharacterKind::Character);
+        saveScenario(path, records);
+        CHECK_THROWS_AS(MappedScenario{path}, std::runtime_error);
+
+        ofstream(path, ios::binary | ios::trunc) << "not a scenario at all";
+        CHECK_THROWS_AS(MappedScenario{path}, std::runtime_error);
+        remove(path.c_str());
+        CHECK_THROWS_AS(MappedScenario{path}, std::runtime_error);
+    }
+
+    TEST_CASE("The try actions return the error instead of throwing")
+    {
+        Cowboy *cowboy = new Cowboy("Cowboy", Point(0, 0));
+        Cowboy *other = new Cowboy("Other", Point(5, 0));
+        OldNinja *ninja = new OldNinja("Ninja", Point(0.5, 0));
+
+        CHECK_EQ(cowboy->tryShoot(nullptr), ActionError::NullTarget);
+        CHECK_EQ(cowboy->tryShoot(cowboy), ActionError::SelfTarget);
+        CHECK_EQ(ninja->trySlash(nullptr), ActionError::NullTarget);
+        CHECK_EQ(ninja->trySlash(ninja), ActionError::SelfTarget);
+        CHECK_EQ(ninja->tryMove(nullptr), ActionError::NullTarget);
+        CHECK_EQ(ninja->tryMove(ninja), ActionError::SelfTarget);
+        CHECK_EQ(cowboy->whatBullets(), 6);
+
+        CHECK_EQ(cowboy->tryShoot(other), ActionError::None);
+        CHECK_EQ(other->whatHealth(), 100);
+        CHECK_EQ(cowboy->whatBullets(), 5);
+        CHECK_EQ(cowboy->tryReload(), ActionError::None);
+        CHECK_EQ(cowboy->whatBullets(), 6);
+        CHECK_EQ(ninja->trySlash(cowboy), ActionError::None);
+        CHECK_EQ(cowboy->whatHealth(), 70);
+        CHECK_EQ(ninja->tryMove(other), ActionError::None);
+        CHECK_EQ(ninja->getLocation().distance(Point(5, 0)), 0);
+
+        other->hit(100);
+        CHECK_EQ(cowboy->tryShoot(other), ActionError::DeadTarget);
+        CHECK_EQ(ninja->trySlash(other), ActionError::DeadTarget);
+        CHECK_EQ(other->tryShoot(cowboy), ActionError::DeadActor);
+        CHECK_EQ(other->tryReload(), ActionError::DeadActor);
+        CHECK_EQ(cowboy->whatBullets(), 6);
+        CHECK_EQ(cowboy->whatHealth(), 70);
+        CHECK_NE(string(describe(ActionError::DeadTarget)), string(describe(ActionError::None)));
+
+        Team team(cowboy);
+        Team2 enemies(ninja);
+        CHECK_EQ(team.tryAttack(nullptr), ActionError::NullTarget);
+        CHECK_EQ(team.tryAttack(&team), ActionError::SelfTarget);
+        CHECK_EQ(team.tryAttack(&enemies), ActionError::None);
+        CHECK_EQ(ninja->whatHealth(), 140);
+        ninja->hit(140);
+        CHECK_EQ(team.tryAttack(&enemies), ActionError::DeadTarget);
+        CHECK_EQ(enemies.tryAttack(&team), ActionError::DeadActor);
+        CHECK_EQ(cowboy->whatBullets(), 5);
+        delete other;
+    }
+
+    TEST_CASE("SmartTeam targets the weakest enemy through the health heap")
+    {
+        HealthHeap heap;
+        CHECK_EQ(heap.weakest(), unsigned{HealthHeap::NO_SLOT});
+        heap.update(3, 50);
+        heap.update(1, 50);
+        heap.update(2, 70);
+        CHECK_EQ(heap.weakest(), 1);
+        heap.update(2, 20);
+        CHECK_EQ(heap.weakest(), 2);
+        heap.remove(2);
+        heap.remove(1);
+        CHECK_EQ(heap.weakest(), 3);
+        CHECK_EQ(heap.size(), 1);
+
+        ScenarioGenerator generator{17};
+        SmartTeam smart{generator.character(), 200};
+        generator.fill(smart, 199);
+        Team2 enemies{generator.character(), 200};
+        generator.fill(enemies, 199);
+        while (smart.stillAlive() > 0 && enemies.stillAlive() > 0)
+        {
+            // Same answer as a scan for the lowest health in slot order
+            Character *expected = nullptr;
+            for (Character *member : enemies.characters)
+            {
+                if (member->isAlive() && (expected == nullptr || member->whatHealth() < expected->whatHealth()))
+                {
+                    expected = member;
+                }
+            }
+            CHECK_EQ(smart.findWeakestEnemy(&enemies), expected);
+            smart.attack(&enemies);
+            if (enemies.stillAlive() > 0)
+            {
+                enemies.attack(&smart);
+            }
+        }
+        CHECK_EQ(enemies.weakestMember(), nullptr);
+    }
+
+    TEST_CASE("Free-for-all battles between many teams")
+    {
+        // Three camps on a line: the middle one is the closest enemy of both others
+        Team left{new Cowboy("Left", Point(-20, 0))};
+        Team2 middle{new OldNinja("Middle", Point(0, 0))};
+        SmartTeam right{new Cowboy("Right", Point(100, 0))};
+        left.add(new Cowboy("Left 2", Point(-21, 0)));
+        right.add(new YoungNinja("Right 2", Point(101, 0)));
+
+        FreeForAll battle;
+        battle.join(&left);
+        battle.join(&middle);
+        battle.join(&right);
+        CHECK_THROWS_AS(battle.join(&left), std::invalid_argument);
+        CHECK_THROWS_AS(battle.join(nullptr), std::invalid_argument);
+        CHECK_EQ(battle.teamCount(), 3);
+        CHECK_EQ(battle.targetOf(0), 1);
+        CHECK_EQ(battle.targetOf(1), 0);
+        CHECK_EQ(battle.targetOf(2), 1);
+        {
+            FreeForAll other;
+            CHECK_THROWS_AS(other.join(&left), std::invalid_argument);
+            Team leaderless;
+            leaderless.add(create_cowboy(0, 0));
+            CHECK_EQ(leaderless.stillAlive(), 1);
+            CHECK_THROWS_AS(other.join(&leaderless), std::invalid_argument);
+        }
+
+        CHECK_EQ(battle.round(), 3);
+        CHECK_EQ(middle.stillAlive(), 1);
+        CHECK_EQ(middle.leader->whatHealth(), 150 - 30);
+        int winner = battle.fight();
+        CHECK_EQ(battle.teamsAlive(), 1);
+        CHECK(winner >= 0);
+        CHECK_GT(battle.team(static_cast<unsigned int>(winner))->stillAlive(), 0);
+        CHECK_EQ(battle.targetOf(static_cast<unsigned int>(winner)), -1);
+        CHECK_EQ(battle.round(), 0);
+
+        // Members that join a team after the team joined the battle can be targeted
+        {
+            auto leaderB = create_cowboy(10, 0);
+            Team teamA{create_cowboy(0, 0)};
+            Team teamB{leaderB};
+            FreeForAll late;
+            late.join(&teamA);
+            late.join(&teamB);
+            teamB.add(create_cowboy(20, 0));
+            teamB.emplace<YoungNinja>("Late", Point(30, 0));
+            leaderB->hit(110);
+            CHECK_EQ(teamB.stillAlive(), 2);
+            CHECK_EQ(late.targetOf(0), 1);
+            CHECK_EQ(late.round(), 2);
+        }
+
+        // With two teams and alternating turns it is the usual battle
+        for (TurnOrder order : {TurnOrder::Alternating, TurnOrder::Simultaneous})
+        {
+            ScenarioGenerator first{23};
+            ScenarioGenerator second{23};
+            Team team{first.character(), 100};
+            first.fill(team, 99);
+            Team2 team2{first.character(), 100};
+            first.fill(team2, 99);
+            Team copy{second.character(), 100};
+            second.fill(copy, 99);
+            Team2 copy2{second.character(), 100};
+            second.fill(copy2, 99);
+
+            FreeForAll pair{order};
+            pair.join(&team);
+            pair.join(&team2);
+            pair.fight();
+            unsigned int rounds = 0;
+            while (copy.stillAlive() > 0 && copy2.stillAlive() > 0)
+            {
+                copy.attack(&copy2);
+                if (copy2.stillAlive() > 0)
+                {
+                    copy2.attack(&copy);
+                }
+                rounds++;
+            }
+            CHECK_EQ(pair.rounds(), rounds);
+            for (unsigned int slot = 0; slot < 100; slot++)
+            {
+                CHECK_EQ(team.characters[slot]->whatHealth(), copy.characters[slot]->whatHealth());
+                CHECK_EQ(team2.characters[slot]->getLocation().distance(copy2.characters[slot]->getLocation()), 0);
+            }
+        }
+    }
+
+    TEST_CASE("Simultaneous rounds read the state of the round start")
+    {
+        // Both cowboys shoot before either is hit
+        Team first{new Cowboy("First", Point(0, 0))};
+        Team second{new Cowboy("Second", Point(3, 0))};
+        first.leader->hit(100);
+        second.leader->hit(100);
+        SoABattle duel{&first, &second};
+        duel.simultaneousRound();
+        CHECK_EQ(duel.stillAlive(0), 0);
+        CHECK_EQ(duel.stillAlive(1), 0);
+        CHECK_THROWS_AS(duel.simultaneousRound(), std::runtime_error);
+
+        // Spreading the units over threads doesn't change the outcome
+        ScenarioGenerator generator{31};
+        ScenarioGenerator same{31};
+        Team team{generator.character(), 200};
+        generator.fill(team, 199);
+        Team2 team2{generator.character(), 200};
+        generator.fill(team2, 199);
+        Team copy{same.character(), 200};
+        same.fill(copy, 199);
+        Team2 copy2{same.character(), 200};
+        same.fill(copy2, 199);
+
+        WorkStealingPool pool{4};
+        SoABattle serial{&team, &team2};
+        SoABattle parallel{&copy, &copy2};
+        unsigned int rounds = 0;
+        while (serial.stillAlive(0) > 0 && serial.stillAlive(1) > 0)
+        {
+            serial.simultaneousRound();
+            parallel.simultaneousRound(&pool);
+            CHECK_EQ(parallel.stillAlive(0), serial.stillAlive(0));
+            CHECK_EQ(parallel.stillAlive(1), serial.stillAlive(1));
+            rounds++;
+        }
+        CHECK_GT(rounds, 1);
+        serial.writeBack();
+        parallel.writeBack();
+        for (unsigned int slot = 0; slot < 200; slot++)
+        {
+            CHECK_EQ(copy.characters[slot]->whatHealth(), team.characters[slot]->whatHealth());
+            CHECK_EQ(copy2.characters[slot]->getLocation().distance(team2.characters[slot]->getLocation()), 0);
+        }
+        CHECK(team.leader->isAlive() == (team.stillAlive() > 0));
+    }
+
+    TEST_CASE("The parallel attack has the outcome of the sequential one")
+    {
+        WorkStealingPool pool{4};
+        for (unsigned int size : {10U, 300U, 3000U})
+        {
+            ScenarioGenerator generator{41};
+            ScenarioGenerator same{41};
+            Team team{generator.character(), size};
+            generator.fill(team, size - 1);
+            Team2 team2{generator.character(), size};
+            generator.fill(team2, size - 1);
+            Team copy{same.character(), size};
+            same.fill(copy, size - 1);
+            Team2 copy2{same.character(), size};
+            same.fill(copy2, size - 1);
+
+            SoABattle sequential{&team, &team2};
+            SoABattle parallel{&copy, &copy2};
+            for (unsigned int i = 0; sequential.stillAlive(0) > 0 && sequential.stillAlive(1) > 0; i++)
+            {
+                sequential.attack(i % 2);
+                parallel.parallelAttack(i % 2, pool);
+                REQUIRE_EQ(parallel.stillAlive(0), sequential.stillAlive(0));
+                REQUIRE_EQ(parallel.stillAlive(1), sequential.stillAlive(1));
+            }
+            CHECK_THROWS_AS(parallel.parallelAttack(0, pool), std::runtime_error);
+            sequential.writeBack();
+            parallel.writeBack();
+            for (unsigned int slot = 0; slot < size; slot++)
+            {
+                CHECK_EQ(copy.characters[slot]->whatHealth(), team.characters[slot]->whatHealth());
+                if (slot < team.cowboyCount)
+                {
+                    CHECK_EQ(static_cast<Cowboy *>(copy.characters[slot])->whatBullets(), static_cast<Cowboy *>(team.characters[slot])->whatBullets());
+                }
+                CHECK_EQ(copy2.characters[slot]->whatHealth(), team2.characters[slot]->whatHealth());
+                CHECK_EQ(copy2.characters[slot]->getLocation().distance(team2.characters[slot]->getLocation()), 0);
+            }
+            CHECK_EQ(copy.leader->getLocation().distance(team.leader->getLocation()), 0);
+            CHECK_EQ(copy2.leader->getLocation().distance(team2.leader->getLocation()), 0);
+        }
+    }
+
+    TEST_CASE("Character names are stored once")
+    {
+        Cowboy first{"Interned name", Point(0, 0)};
+        YoungNinja second{std::string("Interned name"), Point(1, 1)};
+        CHECK_EQ(first.getName(), "Interned name");
+        CHECK_EQ(static_cast<const void *>(first.getName().data()), static_cast<const void *>(second.getName().data()));
+        CHECK_EQ(Character().getName(), "");
+
+        NameTable table;
+        CHECK_EQ(table.intern(""), NameTable::Id{NameTable::EMPTY});
+        NameTable::Id bob = table.intern("Bob");
+        CHECK_EQ(table.intern("Bob"), bob);
+        CHECK_NE(table.intern("Alice"), bob);
+        CHECK_EQ(table.name(bob), "Bob");
+        CHECK_EQ(table.size(), 3);
+        CHECK_THROWS_AS(table.name(3), std::out_of_range);
+
+        // Threads adding the same names get the same ids
+        WorkStealingPool pool{4};
+        vector<NameTable::Id> ids(400);
+        pool.run(ids.size(), [&table, &ids](size_t index)
+                 { ids[index] = table.intern("Unit " + std::to_string(index % 100)); });
+        CHECK_EQ(table.size(), 103);
+        for (size_t index = 0; index < ids.size(); index++)
+        {
+            CHECK_EQ(ids[index], ids[index % 100]);
+            CHECK_EQ(table.name(ids[index]), "Unit " + std::to_string(index % 100));
+        }
+    }
+
+    TEST_CASE("Compact units and float points")
+    {
+        CHECK_EQ(sizeof(CompactUnit), 16);
+        TrainedNinja ninja{"Compact", Point(2.5, -3)};
+        auto cowboy = create_cowboy(1, 1);
+        Team team{cowboy};
+        CompactUnit unit = makeCompactUnit(ninja, 7);
+        CHECK(unit.location().compare(PointF(2.5F, -3.0F)));
+        CHECK_EQ(unit.health, 120);
+        CHECK_EQ(unit.speed, 12);
+        CHECK_EQ(unit.team, 7);
+        CHECK_FALSE(unit.isCowboy());
+        CHECK_FALSE(unit.isLeader());
+        unit = makeCompactUnit(*cowboy, 0);
+        CHECK(unit.isCowboy());
+        CHECK(unit.isLeader());
+        CHECK_EQ(unit.bullets, 6);
+        CHECK_EQ(makeCompactUnit(makeRecord(ninja, 3)).speed, 12);
+        CHECK_THROWS_AS(PointF::moveTowards(PointF(0, 0), PointF(1, 1), -1), std::invalid_argument);
+        CHECK(PointF(0, 0).withinUnitDistance(PointF(0.6F, 0.8F)));
+
+        // Ninjas chasing a target step by step reach it in the same number of moves with float coordinates
+        int chases = 1000;
+        int sameSteps = 0;
+        double worstError = 0;
+        for (int chase = 0; chase < chases; chase++)
+        {
+            Point start(random_float(), random_float());
+            Point target(random_float(), random_float());
+            Point exact = start;
+            PointF compact(start);
+            int exactSteps = 0;
+            int compactSteps = 0;
+            while (!exact.withinUnitDistance(target))
+            {
+                exact = Point::moveTowards(exact, target, 14);
+                exactSteps++;
+            }
+            while (!compact.withinUnitDistance(PointF(target)))
+            {
+                PointF next = PointF::moveTowards(compact, PointF(target), 14);
+                if (compactSteps < exactSteps)
+                {
+                    Point reference = Point::moveTowards(compact.toPoint(), target, 14);
+                    worstError = std::max(worstError, reference.distance(next.toPoint()));
+                }
+                compact = next;
+                compactSteps++;
+            }
+            sameSteps += exactSteps == compactSteps ? 1 : 0;
+            CHECK_LE(std::abs(exactSteps - compactSteps), 1);
+        }
+        CHECK_GE(sameSteps, chases * 99 / 100);
+        CHECK_LT(worstError, 1e-4);
+    }
+
+    TEST_CASE("Unit stats come from the traits table")
+    {
+        static_assert(unitTraits(CharacterKind::TrainedNinja).speed == 12, "The table is usable at compile time");
+        CHECK_EQ(Cowboy("Traits", Point(0, 0)).whatHealth(), COWBOY_TRAITS.health);
+        CHECK_EQ(Cowboy("Traits", Point(0, 0)).whatBullets(), COWBOY_TRAITS.bullets);
+        CHECK_EQ(YoungNinja("Traits", Point(0, 0)).whatHealth(), unitTraits(CharacterKind::YoungNinja).health);
+        CHECK_EQ(OldNinja("Traits", Point(0, 0)).whatSpeed(), unitTraits(CharacterKind::OldNinja).speed);
+        CHECK_EQ(unitTraits(CharacterKind::Character).health, 0);
+
+        // A plain ninja keeps the speed it was built with in the attack loops of every team
+        for (int kind = 0; kind < 3; kind++)
+        {
+            auto leader = create_cowboy(0, 0);
+            Ninja *plain = new Ninja("Plain", 100, Point(0, 0), 3);
+            unique_ptr<Team> team;
+            if (kind == 0)
+            {
+                team = make_unique<Team>(leader);
+            }
+            else if (kind == 1)
+            {
+                team = make_unique<Team2>(leader);
+            }
+            else
+            {
+                team = make_unique<SmartTeam>(leader);
+            }
+            team->add(plain);
+            Team enemies{create_cowboy(50, 0)};
+            team->attack(&enemies);
+            CHECK(plain->getLocation().compare(Point(3, 0)));
+            CHECK_EQ(enemies.stillAlive(), 1);
+        }
+    }
+
+    TEST_CASE("Battle counters")
+    {
+        // Counting is compiled in with make COUNTERS=1, otherwise every count stays 0
+        uint64_t enabled = countersEnabled() ? 1 : 0;
+        CounterSnapshot before = counterSnapshot();
+        Team team{create_cowboy(0, 0)};
+        team.add(create_yninja(1, 0));
+        Team enemies{create_cowboy(40, 0)};
+        team.attack(&enemies);
+        CounterSnapshot events = counterSnapshot() - before;
+        CHECK_EQ(events[BattleCounter::Shots], enabled);
+        CHECK_EQ(events[BattleCounter::Moves], enabled);
+        CHECK_EQ(events[BattleCounter::Slashes], 0);
+        CHECK_EQ(events[BattleCounter::NearestQueries], enabled);
+        CHECK_EQ(events[BattleCounter::KindDispatches], enabled);
+
+        // Counts of other threads are kept after the threads finish
+        before = counterSnapshot();
+        {
+            WorkStealingPool pool{4};
+            pool.run(100, [](size_t)
+                     { countEvent(BattleCounter::Reloads); });
+        }
+        events = counterSnapshot() - before;
+        CHECK_EQ(events[BattleCounter::Reloads], 100 * enabled);
+        CHECK_NE(events.report().find("Reloads: "), string::npos);
+        CHECK_EQ(string(describe(BattleCounter::TargetSwitches)), "Target switches");
+    }
+
+    TEST_CASE("Trace scopes export Chrome trace JSON")
+    {
+        clearTrace();
+        CHECK_FALSE(tracingEnabled());
+        Team team{create_cowboy(0, 0)};
+        team.add(create_yninja(1, 0));
+        auto leader2 = create_cowboy(0, 5);
+        Team2 team2{leader2};
+        team2.add(create_oninja(0, 6));
+        SmartTeam smartTeam{create_tninja(0, 10)};
+        Team enemies{create_cowboy(40, 0)};
+        team.attack(&enemies);
+        CHECK_EQ(traceEventCount(), 0);
+
+        // Only Team2 has to elect a new leader
+        leader2->hit(110);
+
+        startTracing();
+        team.attack(&enemies);
+        team2.attack(&enemies);
+        smartTeam.attack(&enemies);
+        {
+            WorkStealingPool pool{2};
+            pool.run(10, [](size_t)
+                     { TraceScope scope("task"); });
+        }
+        stopTracing();
+        team.attack(&enemies);
+
+        // Team::attack and 4 phases (its leader is alive), Team2::attack and 4 phases (with the leader
+        // election), SmartTeam::attack and 3 phases, 10 tasks
+        CHECK_EQ(traceEventCount(), 24);
+        ostringstream out;
+        writeTrace(out);
+        string json = out.str();
+        CHECK_EQ(json.rfind("{\"traceEvents\":[", 0), 0);
+        for (const char *name : {"Team::attack", "Team2::attack", "SmartTeam::attack", "validation", "leader",
+                                 "target selection", "cowboys", "ninjas", "members", "task"})
+        {
+            CHECK_NE(json.find("\"name\":\"" + string(name) + "\""), string::npos);
+        }
+        size_t events = 0;
+        for (size_t at = json.find("\"ph\":\"X\""); at != string::npos; at = json.find("\"ph\":\"X\"", at + 1))
+        {
+            events++;
+        }
+        CHECK_EQ(events, 24);
+
+        clearTrace();
+        CHECK_EQ(traceEventCount(), 0);
+    }
+
+    TEST_CASE("Moved teams keep tracking their members")
+    {
+        auto cowboy = create_cowboy(0, 0);
+        auto ninja = create_yninja(5, 5);
+        Team first{cowboy};
+        first.add(ninja);
+        Team second{std::move(first)};
+        CHECK_EQ(first.stillAlive(), 0);
+        CHECK_EQ(second.stillAlive(), 2);
+
+        ninja->hit(100);
+        CHECK_EQ(second.stillAlive(), 1);
+        CHECK_EQ(second.weakestMember(), cowboy);
+        Team enemies{create_cowboy(10, 10)};
+        CHECK_EQ(enemies.CloseCharacter(cowboy, &second), cowboy);
+
+        Team third{create_tninja(1, 1)};
+        third = std::move(second);
+        CHECK_EQ(third.stillAlive(), 1);
+        cowboy->hit(50);
+        CHECK_EQ(third.weakestMember(), cowboy);
+        cowboy->hit(60);
+        CHECK_EQ(third.stillAlive(), 0);
+    }
+
+    TEST_CASE("Ninjas don't slash a target the cowboys killed")
+    {
+        auto cowboy = create_cowboy(0, 0);
+        Team team{cowboy};
+        team.add(create_yninja(5, 0));
+        auto enemy = create_cowboy(5.5, 0);
+        enemy->hit(105);
+        Team enemies{enemy};
+        CounterSnapshot before = counterSnapshot();
+        stringstream file;
+        {
+            BattleLog log{file};
+            team.setLog(&log);
+            enemies.setLog(&log);
+            team.attack(&enemies);
+            log.flush();
+            team.setLog(nullptr);
+            enemies.setLog(nullptr);
+        }
+        CHECK_FALSE(enemy->isAlive());
+        CHECK_EQ((counterSnapshot() - before)[BattleCounter::Slashes], 0);
+
+        BattleLogReader reader{file};
+        BattleEvent event{};
+        int shots = 0;
+        int slashes = 0;
+        while (reader.next(event))
+        {
+            shots += event.kind == ActionKind::Shoot ? 1 : 0;
+            slashes += event.kind == ActionKind::Slash ? 1 : 0;
+        }
+        CHECK_EQ(shots, 1);
+        CHECK_EQ(slashes, 0);
+    }
+
+    TEST_CASE("Logged teams only attack teams of the same log")
+    {
+        Team team{create_cowboy(0, 0)};
+        auto enemy = create_cowboy(3, 0);
+        Team enemies{enemy};
+        stringstream file;
+        BattleLog log{file};
+        team.setLog(&log);
+        CHECK_THROWS_AS(team.attack(&enemies), std::invalid_argument);
+        CHECK_EQ(enemy->whatHealth(), 110);
+
+        stringstream otherFile;
+        BattleLog other{otherFile};
+        enemies.setLog(&other);
+        CHECK_THROWS_AS(team.attack(&enemies), std::invalid_argument);
+
+        enemies.setLog(&log);
+        team.attack(&enemies);
+        CHECK_EQ(enemy->whatHealth(), 100);
+        team.setLog(nullptr);
+        enemies.setLog(nullptr);
+    }
+
+    TEST_CASE("Copies of members don't report to the team")
+    {
+        auto ninja = create_oninja(1, 1);
+        Team team{create_cowboy(0, 0)};
+        team.add(ninja);
+        OldNinja copy{*ninja};
+        copy.hit(150);
+        CHECK_FALSE(copy.isAlive());
+        CHECK_EQ(team.stillAlive(), 2);
+
+        OldNinja assigned{"Assigned", Point(2, 2)};
+        assigned = *ninja;
+        assigned.hit(150);
+        CHECK_EQ(team.stillAlive(), 2);
+        CHECK_EQ(team.weakestMember()->whatHealth(), 110);
+    }
+
+    TEST_CASE("Scenario records build members with one factory")
+    {
+        auto ninja = create_tninja(3, 4);
+        ninja->hit(20);
+        ScenarioRecord record = makeRecord(*ninja, 0);
+        delete ninja;
+
+        alignas(Character) unsigned char memory[sizeof(TrainedNinja)];
+        CHECK_EQ(characterSize(record), sizeof(TrainedNinja));
+        Character *built = makeCharacter(record, memory);
+        CHECK(built->whatKind() == CharacterKind::TrainedNinja);
+        CHECK_EQ(built->whatHealth(), 100);
+        CHECK_EQ(built->getLocation().distance(Point(3, 4)), 0);
+        built->~Character();
+
+        // Neither a scenario nor a team turns an unknown kind into some other character
+        record.kind = static_cast<uint8_t>(CharacterKind::Ninja);
+        CHECK_THROWS_AS(characterSize(record), std::invalid_argument);
+        CHECK_THROWS_AS(makeCharacter(record, memory), std::invalid_argument);
+        Team team{create_cowboy(0, 0)};
+        CHECK_THROWS_AS(team.load(&record, 1), std::invalid_argument);
+        CHECK_EQ(team.stillAlive(), 1);
+    }
 }
\ No newline at end of file
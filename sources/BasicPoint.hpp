@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Point.hpp"
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ariel
+{
+    // Point with coordinates of any floating point type, with the same operations as Point.
+    // BasicPoint<float> takes half the memory for the price of about 7 significant digits.
+    template <typename T>
+    class BasicPoint
+    {
+        static_assert(std::is_floating_point<T>::value, "Coordinates must be floating point numbers");
+
+        T x, y;
+
+    public:
+        // Constructor
+        BasicPoint(T x = 0, T y = 0);
+
+        // Conversions from and to Point (rounded to the nearest T)
+        explicit BasicPoint(const Point &point);
+        Point toPoint() const;
+
+        // Get the coordinates of the point
+        T whatX() const;
+        T whatY() const;
+
+        // Calculate the squared distance and the distance between two points
+        T squaredDistance(const BasicPoint &other) const;
+        T distance(const BasicPoint &other) const;
+
+        // Check if a point is at most 1 away without a sqrt (always the same answer as distance(other) <= 1)
+        bool withinUnitDistance(const BasicPoint &other) const;
+
+        // Compare two points and check if they are the same
+        bool compare(const BasicPoint &other) const;
+
+        // Move towards a point by a specified distance, as Point::moveTowards does
+        static BasicPoint moveTowards(const BasicPoint &from, const BasicPoint &to, T dist);
+    };
+
+    using PointF = BasicPoint<float>;
+
+    template <typename T>
+    BasicPoint<T>::BasicPoint(T x, T y) : x(x), y(y) {}
+
+    template <typename T>
+    BasicPoint<T>::BasicPoint(const Point &point) : x(static_cast<T>(point.whatX())), y(static_cast<T>(point.whatY())) {}
+
+    template <typename T>
+    Point BasicPoint<T>::toPoint() const
+    {
+        return Point(static_cast<double>(x), static_cast<double>(y));
+    }
+
+    template <typename T>
+    T BasicPoint<T>::whatX() const
+    {
+        return x;
+    }
+
+    template <typename T>
+    T BasicPoint<T>::whatY() const
+    {
+        return y;
+    }
+
+    template <typename T>
+    T BasicPoint<T>::squaredDistance(const BasicPoint &other) const
+    {
+        T dx = x - other.x;
+        T dy = y - other.y;
+        return dx * dx + dy * dy;
+    }
+
+    template <typename T>
+    T BasicPoint<T>::distance(const BasicPoint &other) const
+    {
+        return std::sqrt(squaredDistance(other));
+    }
+
+    template <typename T>
+    bool BasicPoint<T>::withinUnitDistance(const BasicPoint &other) const
+    {
+        // The largest square whose sqrt still rounds to 1 (1.0000000000000002 for double, as in Point)
+        return squaredDistance(other) <= 1 + std::numeric_limits<T>::epsilon();
+    }
+
+    template <typename T>
+    bool BasicPoint<T>::compare(const BasicPoint &other) const
+    {
+        return x == other.x && y == other.y;
+    }
+
+    template <typename T>
+    BasicPoint<T> BasicPoint<T>::moveTowards(const BasicPoint &from, const BasicPoint &to, T dist)
+    {
+        if (dist < 0)
+        {
+            throw std::invalid_argument("Distance cannot be negative");
+        }
+        T dx = to.x - from.x;
+        T dy = to.y - from.y;
+        T d = std::sqrt(dx * dx + dy * dy);
+        if (d <= dist)
+        {
+            return to;
+        }
+        T ratio = dist / d;
+        return BasicPoint(from.x + dx * ratio, from.y + dy * ratio);
+    }
+}
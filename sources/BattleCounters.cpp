@@ -0,0 +1,134 @@
+#include "BattleCounters.hpp"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    // Counters of the running threads, and the totals of the threads that finished
+    struct CounterRegistry
+    {
+        mutex lock;
+        vector<ThreadCounters *> threads;
+        CounterSnapshot finished;
+    };
+
+    CounterRegistry &registry()
+    {
+        // Never destroyed, threads may finish after the end of main
+        static CounterRegistry *instance = new CounterRegistry();
+        return *instance;
+    }
+
+    // Owns the counters of a thread and adds them to the totals when the thread finishes
+    struct ThreadRegistration
+    {
+        ThreadCounters counters;
+
+        ThreadRegistration()
+        {
+            CounterRegistry &shared = registry();
+            lock_guard<mutex> guard(shared.lock);
+            shared.threads.push_back(&counters);
+        }
+
+        ThreadRegistration(const ThreadRegistration &) = delete;
+        ThreadRegistration &operator=(const ThreadRegistration &) = delete;
+        ThreadRegistration(ThreadRegistration &&) = delete;
+        ThreadRegistration &operator=(ThreadRegistration &&) = delete;
+
+        ~ThreadRegistration()
+        {
+            CounterRegistry &shared = registry();
+            lock_guard<mutex> guard(shared.lock);
+            for (size_t i = 0; i < BATTLE_COUNTER_COUNT; i++)
+            {
+                shared.finished.values[i] += counters.values[i].load(memory_order_relaxed);
+            }
+            shared.threads.erase(find(shared.threads.begin(), shared.threads.end(), &counters));
+            threadCounters = nullptr;
+        }
+    };
+}
+
+thread_local ThreadCounters *ariel::threadCounters = nullptr;
+
+ThreadCounters *ariel::registerThreadCounters()
+{
+    thread_local ThreadRegistration registration;
+    threadCounters = &registration.counters;
+    return threadCounters;
+}
+
+CounterSnapshot ariel::counterSnapshot()
+{
+    CounterRegistry &shared = registry();
+    lock_guard<mutex> guard(shared.lock);
+    CounterSnapshot snapshot = shared.finished;
+    for (const ThreadCounters *counters : shared.threads)
+    {
+        for (size_t i = 0; i < BATTLE_COUNTER_COUNT; i++)
+        {
+            snapshot.values[i] += counters->values[i].load(memory_order_relaxed);
+        }
+    }
+    return snapshot;
+}
+
+uint64_t CounterSnapshot::operator[](BattleCounter counter) const
+{
+    return values[static_cast<size_t>(counter)];
+}
+
+CounterSnapshot CounterSnapshot::operator-(const CounterSnapshot &earlier) const
+{
+    CounterSnapshot difference;
+    for (size_t i = 0; i < BATTLE_COUNTER_COUNT; i++)
+    {
+        difference.values[i] = values[i] - earlier.values[i];
+    }
+    return difference;
+}
+
+string CounterSnapshot::report() const
+{
+    string out;
+    for (size_t i = 0; i < BATTLE_COUNTER_COUNT; i++)
+    {
+        out += describe(static_cast<BattleCounter>(i));
+        out += ": ";
+        out += to_string(values[i]);
+        out += '\n';
+    }
+    return out;
+}
+
+const char *ariel::describe(BattleCounter counter)
+{
+    switch (counter)
+    {
+    case BattleCounter::NearestQueries:
+        return "Nearest queries";
+    case BattleCounter::NearestCacheHits:
+        return "Nearest cache hits";
+    case BattleCounter::KindDispatches:
+        return "Kind dispatches";
+    case BattleCounter::Moves:
+        return "Moves";
+    case BattleCounter::Shots:
+        return "Shots";
+    case BattleCounter::Reloads:
+        return "Reloads";
+    case BattleCounter::Slashes:
+        return "Slashes";
+    case BattleCounter::LeaderChanges:
+        return "Leader changes";
+    case BattleCounter::TargetSwitches:
+        return "Target switches";
+    }
+    return "Unknown counter";
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ariel
+{
+    // Events counted on the hot paths of the battles when the program is built with
+    // BATTLE_COUNTERS defined (make COUNTERS=1). Without it counting compiles to nothing.
+    enum class BattleCounter : unsigned char
+    {
+        // Closest character queries (Team::CloseCharacter)
+        NearestQueries,
+
+        // Closest enemies of SmartTeam ninjas answered from their cache
+        NearestCacheHits,
+
+        // Members dispatched to the attack kernel of their kind (the tag switch that replaced dynamic_cast)
+        KindDispatches,
+
+        // Ninja moves that called Point::moveTowards
+        Moves,
+
+        Shots,
+        Reloads,
+        Slashes,
+
+        // Leaders replaced after they died (Team::newLeader)
+        LeaderChanges,
+
+        // Targets replaced after they died (Team::isTarget)
+        TargetSwitches
+    };
+
+    const std::size_t BATTLE_COUNTER_COUNT = 9;
+
+    // Get the name of a counter
+    const char *describe(BattleCounter counter);
+
+    // Totals of all the threads at one moment. Subtract two snapshots to get the events in between.
+    struct CounterSnapshot
+    {
+        std::array<std::uint64_t, BATTLE_COUNTER_COUNT> values{};
+
+        std::uint64_t operator[](BattleCounter counter) const;
+        CounterSnapshot operator-(const CounterSnapshot &earlier) const;
+
+        // One "name: value" line per counter
+        std::string report() const;
+    };
+
+    // Check if the program counts events (built with BATTLE_COUNTERS)
+    constexpr bool countersEnabled()
+    {
+#ifdef BATTLE_COUNTERS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Sum the counters of all the threads, including the ones that finished
+    CounterSnapshot counterSnapshot();
+
+    // Counters of one thread. Only their thread writes them, others read them for snapshots.
+    struct ThreadCounters
+    {
+        std::array<std::atomic<std::uint64_t>, BATTLE_COUNTER_COUNT> values{};
+    };
+
+    // Counters of the calling thread, nullptr until it counts its first event
+    extern thread_local ThreadCounters *threadCounters;
+
+    // Register the counters of the calling thread
+    ThreadCounters *registerThreadCounters();
+
+    // Count one event in the counters of the calling thread
+    inline void countEvent(BattleCounter counter)
+    {
+#ifdef BATTLE_COUNTERS
+        ThreadCounters *counters = threadCounters != nullptr ? threadCounters : registerThreadCounters();
+        std::atomic<std::uint64_t> &value = counters->values[static_cast<std::size_t>(counter)];
+        // A single writer: no read-modify-write instruction needed
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+#else
+        (void)counter;
+#endif
+    }
+}
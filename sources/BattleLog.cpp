@@ -0,0 +1,277 @@
+#include "BattleLog.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    // File header: magic, version and size of an event
+    const char MAGIC[4] = {'N', 'C', 'L', 'G'};
+    const uint16_t VERSION = 1;
+
+    const uint32_t SLOT_MASK = 0xFFFFFF;
+    const unsigned int TEAM_SHIFT = 24;
+
+    static_assert(sizeof(BattleEvent) == 32, "Events are written as fixed 32 byte records");
+    static_assert(is_trivially_copyable<BattleEvent>::value, "Events are written as raw bytes");
+}
+
+uint32_t ariel::makeUnitId(uint8_t team, unsigned int slot)
+{
+    if (slot > SLOT_MASK)
+    {
+        throw out_of_range("Slot too large for a unit id");
+    }
+    return (static_cast<uint32_t>(team) << TEAM_SHIFT) | slot;
+}
+
+BattleLog::BattleLog(ostream &out, size_t capacity) : out(out)
+{
+    if (capacity < 2)
+    {
+        throw invalid_argument("The ring buffer needs room for at least two events");
+    }
+    ring.resize(capacity);
+    writeHeader();
+    writer = thread(&BattleLog::writerLoop, this);
+}
+
+BattleLog::~BattleLog()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wakeWriter.notify_one();
+    writer.join();
+    out.flush();
+}
+
+void BattleLog::writeHeader()
+{
+    uint16_t eventSize = sizeof(BattleEvent);
+    out.write(MAGIC, sizeof(MAGIC));
+    out.write(reinterpret_cast<const char *>(&VERSION), sizeof(VERSION));
+    out.write(reinterpret_cast<const char *>(&eventSize), sizeof(eventSize));
+}
+
+uint8_t BattleLog::addTeam()
+{
+    if (rounds.size() > numeric_limits<uint8_t>::max())
+    {
+        throw runtime_error("A battle log can't hold more than 256 teams");
+    }
+    rounds.push_back(0);
+    return static_cast<uint8_t>(rounds.size() - 1);
+}
+
+void BattleLog::beginAttack(uint8_t team)
+{
+    rounds.at(team)++;
+}
+
+void BattleLog::record(ActionKind kind, uint32_t actor, uint32_t target, int value, uint8_t extra, const Point &location)
+{
+    uint64_t index = head.load(memory_order_relaxed);
+    if (index - tail.load(memory_order_acquire) == ring.size())
+    {
+        // Full: let the writer catch up
+        unique_lock<mutex> guard(lock);
+        wakeWriter.notify_one();
+        spaceFreed.wait(guard, [this, index]
+                        { return index - tail.load(memory_order_acquire) < ring.size(); });
+    }
+
+    BattleEvent &event = ring[index % ring.size()];
+    event.round = kind == ActionKind::Join ? 0 : rounds[actor >> TEAM_SHIFT];
+    event.actor = actor;
+    event.target = target;
+    event.value = static_cast<int16_t>(clamp(value, static_cast<int>(numeric_limits<int16_t>::min()), static_cast<int>(numeric_limits<int16_t>::max())));
+    event.kind = kind;
+    event.extra = extra;
+    event.x = location.whatX();
+    event.y = location.whatY();
+    head.store(index + 1, memory_order_release);
+
+    // Wake the writer once half of the ring is waiting
+    if (index + 1 - tail.load(memory_order_acquire) == ring.size() / 2)
+    {
+        lock_guard<mutex> guard(lock);
+        wakeWriter.notify_one();
+    }
+}
+
+void BattleLog::flush()
+{
+    unique_lock<mutex> guard(lock);
+    flushing = true;
+    wakeWriter.notify_one();
+    uint64_t end = head.load(memory_order_acquire);
+    spaceFreed.wait(guard, [this, end]
+                    { return tail.load(memory_order_acquire) >= end; });
+    flushing = false;
+    out.flush();
+}
+
+uint64_t BattleLog::recorded() const
+{
+    return head.load(memory_order_acquire);
+}
+
+void BattleLog::writerLoop()
+{
+    unique_lock<mutex> guard(lock);
+    while (true)
+    {
+        wakeWriter.wait(guard, [this]
+                        { return stopping || flushing || head.load(memory_order_acquire) - tail.load(memory_order_acquire) >= ring.size() / 2; });
+        uint64_t begin = tail.load(memory_order_acquire);
+        uint64_t end = head.load(memory_order_acquire);
+        if (begin != end)
+        {
+            // The recorder only writes slots past the tail, so the range can be written without the lock
+            guard.unlock();
+            writeRange(begin, end);
+            guard.lock();
+            tail.store(end, memory_order_release);
+            spaceFreed.notify_all();
+        }
+        else if (stopping)
+        {
+            return;
+        }
+        else if (flushing)
+        {
+            spaceFreed.notify_all();
+            // Wait for the next request instead of spinning on an empty ring
+            wakeWriter.wait(guard);
+        }
+    }
+}
+
+void BattleLog::writeRange(uint64_t begin, uint64_t end)
+{
+    // At most two contiguous pieces of the ring
+    while (begin != end)
+    {
+        size_t first = static_cast<size_t>(begin % ring.size());
+        size_t count = static_cast<size_t>(min<uint64_t>(end - begin, ring.size() - first));
+        out.write(reinterpret_cast<const char *>(&ring[first]), static_cast<streamsize>(count * sizeof(BattleEvent)));
+        begin += count;
+    }
+}
+
+BattleLogReader::BattleLogReader(istream &in) : in(in)
+{
+    char magic[sizeof(MAGIC)];
+    uint16_t version = 0;
+    uint16_t eventSize = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char *>(&version), sizeof(version));
+    in.read(reinterpret_cast<char *>(&eventSize), sizeof(eventSize));
+    if (!in || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        throw runtime_error("Not a battle log");
+    }
+    if (version != VERSION || eventSize != sizeof(BattleEvent))
+    {
+        throw runtime_error("Unsupported battle log version");
+    }
+    buffer.reserve(4096);
+}
+
+bool BattleLogReader::next(BattleEvent &event)
+{
+    if (position == buffer.size())
+    {
+        buffer.resize(buffer.capacity());
+        in.read(reinterpret_cast<char *>(buffer.data()), static_cast<streamsize>(buffer.size() * sizeof(BattleEvent)));
+        size_t bytes = static_cast<size_t>(in.gcount());
+        if (bytes % sizeof(BattleEvent) != 0)
+        {
+            throw runtime_error("Truncated battle log");
+        }
+        buffer.resize(bytes / sizeof(BattleEvent));
+        position = 0;
+        if (buffer.empty())
+        {
+            return false;
+        }
+    }
+    event = buffer[position++];
+    return true;
+}
+
+ReplayUnit &BattleReplay::unit(uint32_t id)
+{
+    size_t team = id >> TEAM_SHIFT;
+    size_t slot = id & SLOT_MASK;
+    if (team >= teams.size())
+    {
+        teams.resize(team + 1);
+    }
+    if (slot >= teams[team].size())
+    {
+        teams[team].resize(slot + 1);
+    }
+    return teams[team][slot];
+}
+
+void BattleReplay::apply(const BattleEvent &event)
+{
+    ReplayUnit &actor = unit(event.actor);
+    switch (event.kind)
+    {
+    case ActionKind::Join:
+        actor.present = true;
+        actor.kind = static_cast<uint8_t>(event.value);
+        actor.health = static_cast<int>(event.target);
+        actor.bullets = event.extra;
+        break;
+    case ActionKind::Shoot:
+    case ActionKind::Slash:
+    {
+        ReplayUnit &target = unit(event.target);
+        target.health = max(0, target.health - event.value);
+        if (event.kind == ActionKind::Shoot && actor.bullets > 0)
+        {
+            actor.bullets--;
+        }
+        break;
+    }
+    case ActionKind::Reload:
+        actor.bullets = event.extra;
+        break;
+    case ActionKind::Move:
+        break;
+    default:
+        throw runtime_error("Unknown event in battle log");
+    }
+    actor.location = Point(event.x, event.y);
+}
+
+uint64_t BattleReplay::replay(BattleLogReader &reader)
+{
+    uint64_t events = 0;
+    BattleEvent event;
+    while (reader.next(event))
+    {
+        apply(event);
+        events++;
+    }
+    return events;
+}
+
+const vector<ReplayUnit> &BattleReplay::team(uint8_t id) const
+{
+    if (id >= teams.size())
+    {
+        throw out_of_range("No such team in the log");
+    }
+    return teams[id];
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "Point.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+namespace ariel
+{
+    // What a logged event records
+    enum class ActionKind : std::uint8_t
+    {
+        Join,   // a member entered the log: target is its health, value its CharacterKind, extra its bullets
+        Shoot,  // value is the damage dealt
+        Reload, // extra is the number of bullets after reloading
+        Slash,  // value is the damage dealt
+        Move    // x and y are the new location
+    };
+
+    // One fixed-size record of the log. Unit ids hold the team id of the log in the top
+    // 8 bits and the slot of the member in its team in the low 24 bits.
+    struct BattleEvent
+    {
+        // Number of attacks the team of the actor started so far (0 for joins)
+        std::uint32_t round;
+        std::uint32_t actor;
+        std::uint32_t target;
+        std::int16_t value;
+        ActionKind kind;
+        std::uint8_t extra;
+
+        // Location of the actor after the action
+        double x;
+        double y;
+    };
+
+    // Build the id of the member in the given slot of a team
+    std::uint32_t makeUnitId(std::uint8_t team, unsigned int slot);
+
+    // Binary event log of battles. Events go to a preallocated ring buffer that a background
+    // thread writes to the stream, so recording an action never formats text or allocates.
+    class BattleLog
+    {
+    public:
+        // Constructor with the stream to write to and the number of events in the ring buffer
+        explicit BattleLog(std::ostream &out, std::size_t capacity = 1 << 16);
+
+        BattleLog(const BattleLog &) = delete;
+        BattleLog &operator=(const BattleLog &) = delete;
+        BattleLog(BattleLog &&) = delete;
+        BattleLog &operator=(BattleLog &&) = delete;
+
+        // Write the remaining events and stop the writer thread
+        ~BattleLog();
+
+        // Get a new team id (at most 256 teams per log)
+        std::uint8_t addTeam();
+
+        // Start a new round for a team
+        void beginAttack(std::uint8_t team);
+
+        // Record an event of the current round of the team of the actor
+        void record(ActionKind kind, std::uint32_t actor, std::uint32_t target, int value, std::uint8_t extra, const Point &location);
+
+        // Wait until every recorded event was written to the stream
+        void flush();
+
+        // Get the number of events recorded so far
+        std::uint64_t recorded() const;
+
+    private:
+        std::ostream &out;
+        std::vector<BattleEvent> ring;
+        std::vector<std::uint32_t> rounds;
+
+        // Total number of events put in the ring and written out of it
+        std::atomic<std::uint64_t> head{0};
+        std::atomic<std::uint64_t> tail{0};
+
+        std::mutex lock;
+        std::condition_variable wakeWriter;
+        std::condition_variable spaceFreed;
+        bool flushing = false;
+        bool stopping = false;
+        std::thread writer;
+
+        void writeHeader();
+        void writerLoop();
+        void writeRange(std::uint64_t begin, std::uint64_t end);
+    };
+
+    // Reader of the files written by BattleLog
+    class BattleLogReader
+    {
+    public:
+        // Constructor checking the header of the log
+        explicit BattleLogReader(std::istream &in);
+
+        // Read the next event, false at the end of the log
+        bool next(BattleEvent &event);
+
+    private:
+        std::istream &in;
+        std::vector<BattleEvent> buffer;
+        std::size_t position = 0;
+    };
+
+    // State of a unit rebuilt from a log
+    struct ReplayUnit
+    {
+        bool present = false;
+        std::uint8_t kind = 0;
+        int health = 0;
+        int bullets = 0;
+        Point location;
+    };
+
+    // Rebuild the state of the teams of a log by applying its events in order
+    class BattleReplay
+    {
+    public:
+        // Apply one event
+        void apply(const BattleEvent &event);
+
+        // Apply every event of a log, returns the number of events
+        std::uint64_t replay(BattleLogReader &reader);
+
+        // Get the units of a team, indexed by slot
+        const std::vector<ReplayUnit> &team(std::uint8_t id) const;
+
+    private:
+        std::vector<std::vector<ReplayUnit>> teams;
+
+        ReplayUnit &unit(std::uint32_t id);
+    };
+}
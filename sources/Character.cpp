@@ -1,4 +1,7 @@
 #include "Character.hpp"
+#include "TextFormat.hpp"
+#include "UnitTraits.hpp"
+#include "BattleCounters.hpp"
 #include <string>
 #include <iostream>
 #include <stdexcept>
@@ -7,7 +10,9 @@ using namespace std;
 using namespace ariel;
 
 // Constructors
-Character::Character(string name, int health, Point position) : name(name), health(health), position(position)
+Character::Character(string_view name, int health, Point position) : Character(name, health, position, CharacterKind::Character) {}
+
+Character::Character(string_view name, int health, Point position, CharacterKind kind) : name(NameTable::global().intern(name)), health(health), position(position), kind(kind)
 {
     // Validate health value
     if (health < 0)
@@ -16,9 +21,35 @@ Character::Character(string name, int health, Point position) : name(name), heal
     }
 }
 
-Cowboy::Cowboy(string name, Point position) : Character(name, 110, position), bullets(6) {}
+Character::Character(const Character &other)
+    : position(other.position), health(other.health), name(other.name), inTeam(other.inTeam), leader(other.leader), kind(other.kind) {}
+
+Character &Character::operator=(const Character &other)
+{
+    position = other.position;
+    health = other.health;
+    name = other.name;
+    inTeam = other.inTeam;
+    leader = other.leader;
+    kind = other.kind;
+    observer = nullptr;
+    return *this;
+}
+
+Character::Character(Character &&other) noexcept : Character(static_cast<const Character &>(other)) {}
+
+Character &Character::operator=(Character &&other) noexcept
+{
+    return *this = static_cast<const Character &>(other);
+}
+
+Cowboy::Cowboy(string_view name, Point position) : Character(name, COWBOY_TRAITS.health, position, CharacterKind::Cowboy), bullets(COWBOY_TRAITS.bullets) {}
+
+Cowboy::Cowboy() : Character("", 0, Point(0, 0), CharacterKind::Cowboy) {}
 
-Ninja::Ninja(string name, int health, Point position, int speed) : Character(name, health, position), speed(speed)
+Ninja::Ninja(string_view name, int health, Point position, int speed) : Ninja(name, health, position, speed, CharacterKind::Ninja) {}
+
+Ninja::Ninja(string_view name, int health, Point position, int speed, CharacterKind kind) : Character(name, health, position, kind), speed(speed)
 {
     // Validate health and speed values
     if (health < 0)
@@ -31,11 +62,20 @@ Ninja::Ninja(string name, int health, Point position, int speed) : Character(nam
     }
 }
 
-YoungNinja::YoungNinja(string name, Point position) : Ninja(name, 100, position, 14) {}
+Ninja::Ninja() : Character("", 0, Point(0, 0), CharacterKind::Ninja) {}
+
+YoungNinja::YoungNinja(string_view name, Point position) : Ninja(name, unitTraits(CharacterKind::YoungNinja).health, position, unitTraits(CharacterKind::YoungNinja).speed, CharacterKind::YoungNinja) {}
+
+YoungNinja::YoungNinja() : Ninja("", 0, Point(0, 0), 0, CharacterKind::YoungNinja) {}
+
+OldNinja::OldNinja(string_view name, Point position) : Ninja(name, unitTraits(CharacterKind::OldNinja).health, position, unitTraits(CharacterKind::OldNinja).speed, CharacterKind::OldNinja) {}
+
+OldNinja::OldNinja() : Ninja("", 0, Point(0, 0), 0, CharacterKind::OldNinja) {}
+
+TrainedNinja::TrainedNinja(string_view name, Point position) : Ninja(name, unitTraits(CharacterKind::TrainedNinja).health, position, unitTraits(CharacterKind::TrainedNinja).speed, CharacterKind::TrainedNinja) {}
 
-OldNinja::OldNinja(string name, Point position) : Ninja(name, 150, position, 8) {}
+TrainedNinja::TrainedNinja() : Ninja("", 0, Point(0, 0), 0, CharacterKind::TrainedNinja) {}
 
-TrainedNinja::TrainedNinja(string name, Point position) : Ninja(name, 120, position, 12) {}
 void Character::allowTeam()
 {
     if (inTeam)
@@ -64,6 +104,21 @@ void Character::performSetLeader()
     leader = true;
 }
 
+CharacterKind Character::whatKind() const
+{
+    return kind;
+}
+
+bool Character::isCowboy() const
+{
+    return kind == CharacterKind::Cowboy;
+}
+
+bool Character::isNinja() const
+{
+    return kind == CharacterKind::Ninja || kind == CharacterKind::YoungNinja || kind == CharacterKind::TrainedNinja || kind == CharacterKind::OldNinja;
+}
+
 bool Character::isInTeam() const
 {
     return inTeam;
@@ -74,6 +129,11 @@ bool Character::isLeader() const
     return leader;
 }
 
+void Character::setObserver(CharacterObserver *observer)
+{
+    this->observer = observer;
+}
+
 int Character::whatHealth() const
 {
     return health;
@@ -101,6 +161,17 @@ void Character::applyDamage(int damage)
         {
             health = 0;
         }
+        if (observer != nullptr)
+        {
+            if (isAlive())
+            {
+                observer->characterHit(this);
+            }
+            else
+            {
+                observer->characterDied(this);
+            }
+        }
     }
 }
 
@@ -110,9 +181,9 @@ void Character::hit(int damage)
     applyDamage(damage);
 }
 
-string Character::getName() const
+string_view Character::getName() const
 {
-    return name;
+    return NameTable::global().name(name);
 }
 Point Character::getLocation() const
 {
@@ -121,20 +192,55 @@ Point Character::getLocation() const
 std::string Character::print() const
 {
     std::string data;
+    printTo(data);
+    return data;
+}
 
+void Character::printTo(std::string &out, bool colour) const
+{
     if (isAlive())
     {
-        data += "Name: " + name + "\n";
-        data += "Health: " + std::to_string(health) + " ❤️\n";
-        data += "Position: " + position.print() + "\n";
+        out += "Name: ";
+        out += getName();
+        out += "\nHealth: ";
+        appendInt(out, health);
+        out += " ❤️\n";
     }
     else
     {
-        data += "☠️☠️☠️ " + name + " ☠️☠️☠️\n";
-        data += "Position: " + position.print() + "\n";
+        out += "☠️☠️☠️ ";
+        out += getName();
+        out += " ☠️☠️☠️\n";
     }
-
-    return data;
+    out += "Position: ";
+    position.printTo(out, colour);
+    out += '\n';
+}
+
+void Character::printStatsTo(std::string &out, const char *title, const char *lastLabel, int lastValue, const char *bottom, bool colour) const
+{
+    out += "    ╔═════════════════════════════╗\n";
+    out += title;
+    out += "    ╟─────────────────────────────╢\n";
+    out += "    ║   Name:     ";
+    size_t start = out.size();
+    out += getName();
+    padSince(out, start, 16);
+    out += "║\n    ║   Health:   ";
+    start = out.size();
+    appendInt(out, health);
+    padSince(out, start, 16);
+    out += "║\n    ║   Position: ";
+    start = out.size();
+    position.printTo(out, colour);
+    padSince(out, start, 16);
+    out += "║\n";
+    out += lastLabel;
+    start = out.size();
+    appendInt(out, lastValue);
+    padSince(out, start, 16);
+    out += "║\n";
+    out += bottom;
 }
 
 double Character::distance(const Character *character) const
@@ -156,9 +262,20 @@ double Character::calculateDistance(const Character *character) const
     return position.distance(character->getLocation());
 }
 
+double Character::squaredDistance(const Character *character) const
+{
+    validateCharacter(character);
+    return position.squaredDistance(character->getLocation());
+}
+
 void Character::addLocation(Point point)
 {
+    Point from = position;
     position = point;
+    if (observer != nullptr)
+    {
+        observer->characterMoved(this, from);
+    }
 }
 
 void Cowboy::shoot(Character *enemy)
@@ -166,6 +283,11 @@ void Cowboy::shoot(Character *enemy)
     validateShootTarget(enemy);
     performShootAction(enemy);
 }
+int Cowboy::whatBullets() const
+{
+    return bullets;
+}
+
 void Cowboy::reload()
 {
     validateReload();
@@ -182,13 +304,56 @@ void Cowboy::validateReload()
 
 void Cowboy::performReload()
 {
-    int bulletsToAdd = 6 - bullets;
+    countEvent(BattleCounter::Reloads);
+    int bulletsToAdd = COWBOY_TRAITS.bullets - bullets;
     if (bulletsToAdd > 0)
     {
         bullets += bulletsToAdd;
     }
 }
 
+ActionError Cowboy::tryShoot(Character *enemy)
+{
+    ActionError error = checkShoot(enemy);
+    if (error == ActionError::None)
+    {
+        performShootAction(enemy);
+    }
+    return error;
+}
+
+ActionError Cowboy::tryReload()
+{
+    if (!isAlive())
+    {
+        return ActionError::DeadActor;
+    }
+    performReload();
+    return ActionError::None;
+}
+
+// Same checks in the same order as validateShootTarget
+ActionError Cowboy::checkShoot(const Character *enemy) const
+{
+    if (enemy == nullptr)
+    {
+        return ActionError::NullTarget;
+    }
+    if (this == enemy)
+    {
+        return ActionError::SelfTarget;
+    }
+    if (!isAlive())
+    {
+        return ActionError::DeadActor;
+    }
+    if (!enemy->isAlive())
+    {
+        return ActionError::DeadTarget;
+    }
+    return ActionError::None;
+}
+
 void Cowboy::validateShootTarget(Character *enemy)
 {
     validateEnemyNotNull(enemy);
@@ -236,8 +401,9 @@ void Cowboy::performShootAction(Character *enemy)
 {
     if (hasboolets())
     {
+        countEvent(BattleCounter::Shots);
         bullets--;
-        enemy->hit(10);
+        enemy->hit(COWBOY_TRAITS.damage);
     }
 }
 
@@ -246,20 +412,12 @@ bool Cowboy::hasboolets() const
     return bullets > 0;
 }
 
-string Cowboy::print() const
+void Cowboy::printTo(string &out, bool colour) const
 {
-    stringstream out;
     // break line
-    out << endl;
-    out << "    ╔═════════════════════════════╗" << endl;
-    out << "    ║         Cowboy Stats        ║" << endl;
-    out << "    ╟─────────────────────────────╢" << endl;
-    out << "    ║   Name:     " << setw(16) << left << getName() << "║" << endl;
-    out << "    ║   Health:   " << setw(16) << left << whatHealth() << "║" << endl;
-    out << "    ║   Position: " << setw(16) << left << getLocation().print() << "║" << endl;
-    out << "    ║   Ammo:     " << setw(16) << left << bullets << "║" << endl;
-    out << "    ╚═════════════════════════════╝" << endl;
-    return out.str();
+    out += '\n';
+    printStatsTo(out, "    ║         Cowboy Stats        ║\n", "    ║   Ammo:     ", bullets,
+                 "    ╚═════════════════════════════╝\n", colour);
 }
 
 void Ninja::slash(Character *enemy)
@@ -271,6 +429,66 @@ void Ninja::slash(Character *enemy)
     performSlash(enemy);
 }
 
+ActionError Ninja::trySlash(Character *enemy)
+{
+    ActionError error = checkSlash(enemy);
+    if (error == ActionError::None)
+    {
+        performSlash(enemy);
+    }
+    return error;
+}
+
+ActionError Ninja::tryMove(Character *enemy)
+{
+    ActionError error = checkMove(enemy);
+    if (error == ActionError::None)
+    {
+        performMove(enemy);
+    }
+    return error;
+}
+
+// Same checks in the same order as slash()
+ActionError Ninja::checkSlash(const Character *enemy) const
+{
+    if (enemy == nullptr)
+    {
+        return ActionError::NullTarget;
+    }
+    if (this == enemy)
+    {
+        return ActionError::SelfTarget;
+    }
+    if (!isAlive())
+    {
+        return ActionError::DeadActor;
+    }
+    if (!enemy->isAlive())
+    {
+        return ActionError::DeadTarget;
+    }
+    return ActionError::None;
+}
+
+// Same checks in the same order as validateMove
+ActionError Ninja::checkMove(const Character *enemy) const
+{
+    if (enemy == nullptr)
+    {
+        return ActionError::NullTarget;
+    }
+    if (!isAlive())
+    {
+        return ActionError::DeadActor;
+    }
+    if (this == enemy)
+    {
+        return ActionError::SelfTarget;
+    }
+    return ActionError::None;
+}
+
 void Ninja::validateEnemyNotNull(Character *enemy)
 {
     if (enemy == nullptr)
@@ -306,25 +524,29 @@ void Ninja::validateEnemyAlive(Character *enemy)
 
 void Ninja::performSlash(Character *enemy)
 {
-    if (distance(enemy) <= 1)
+    performSlash(enemy, NINJA_TRAITS.damage);
+}
+
+void Ninja::performSlash(Character *enemy, int damage)
+{
+    if (inSlashRange(enemy))
     {
-        enemy->hit(40);
+        countEvent(BattleCounter::Slashes);
+        enemy->hit(damage);
     }
 }
 
-string Ninja::print() const
+bool Ninja::inSlashRange(const Character *enemy) const
 {
-    stringstream out;
-    out << "\n   Members: " << endl;
-    out << "    ╔═════════════════════════════╗" << endl;
-    out << "    ║         Ninja Stats         ║" << endl;
-    out << "    ╟─────────────────────────────╢" << endl;
-    out << "    ║   Name:     " << setw(16) << left << getName() << "║" << endl;
-    out << "    ║   Health:   " << setw(16) << left << whatHealth() << "║" << endl;
-    out << "    ║   Position: " << setw(16) << left << getLocation().print() << "║" << endl;
-    out << "    ║   Speed:    " << setw(16) << left << speed << "║" << endl;
-    out << "    ╚═════════════════════errormsg════════╝" << endl;
-    return out.str();
+    validateCharacter(enemy);
+    return getLocation().withinUnitDistance(enemy->getLocation());
+}
+
+void Ninja::printTo(string &out, bool colour) const
+{
+    out += "\n   Members: \n";
+    printStatsTo(out, "    ║         Ninja Stats         ║\n", "    ║   Speed:    ", speed,
+                 "    ╚═════════════════════errormsg════════╝\n", colour);
 }
 
 void Ninja::move(Character *enemy)
@@ -333,6 +555,11 @@ void Ninja::move(Character *enemy)
     performMove(enemy);
 }
 
+int Ninja::whatSpeed() const
+{
+    return speed;
+}
+
 void Ninja::validateMove(Character *enemy)
 {
     if (enemy == nullptr)
@@ -355,16 +582,42 @@ void Ninja::validateMove(Character *enemy)
 }
 
 void Ninja::performMove(Character *enemy)
+{
+    performMove(enemy, speed);
+}
+
+void Ninja::performMove(Character *enemy, double distance)
 {
     Point enemyPos = enemy->getLocation();
     Point myPos = getLocation();
 
     if (!myPos.compare(enemyPos))
     {
-        addLocation(Point::moveTowards(myPos, enemyPos, speed)); // set new position
+        countEvent(BattleCounter::Moves);
+        addLocation(Point::moveTowards(myPos, enemyPos, distance)); // set new position
     }
 }
+
+const char *ariel::describe(ActionError error)
+{
+    switch (error)
+    {
+    case ActionError::None:
+        return "No error";
+    case ActionError::NullTarget:
+        return "NULL target";
+    case ActionError::SelfTarget:
+        return "Can't target itself";
+    case ActionError::DeadActor:
+        return "Dead characters can't act";
+    case ActionError::DeadTarget:
+        return "Can't target a dead character";
+    }
+    return "Unknown error";
+}
+
 void Character::errormsg(std::string msg) const
 {
-    std::cerr << "Error: " << msg << std::endl;
+    // std::cerr is unbuffered, a flush per message would be one more call for nothing
+    std::cerr << "Error: " << msg << '\n';
 }
@@ -3,42 +3,113 @@
 #include <sstream>
 #include <iomanip>
 #include "Point.hpp"
+#include "NameTable.hpp"
 #include <string>
+#include <string_view>
 
 namespace ariel
 {
 
+    class Character;
+
+    // Concrete type of a character, checked instead of RTTI on the attack paths
+    enum class CharacterKind : unsigned char
+    {
+        Character,
+        Cowboy,
+        Ninja,
+        YoungNinja,
+        TrainedNinja,
+        OldNinja
+    };
+
+    // Why an action wasn't performed, returned by the try* functions instead of throwing
+    enum class ActionError : unsigned char
+    {
+        None,
+        NullTarget,
+        SelfTarget,
+        DeadActor,
+        DeadTarget
+    };
+
+    // Get a short description of an action error
+    const char *describe(ActionError error);
+
+    // Interface for objects that keep track of the position and health of characters (e.g. a team's spatial index)
+    class CharacterObserver
+    {
+    public:
+        // Called after the character changed its location
+        virtual void characterMoved(Character *character, const Point &from) = 0;
+
+        // Called when the character was hit and is still alive
+        virtual void characterHit(Character *character) = 0;
+
+        // Called once, when the health of the character drops to zero
+        virtual void characterDied(Character *character) = 0;
+
+        // Called by a team when a living character joins it in the given slot, for the observers
+        // of whole teams (see Team::setObserver); characters themselves never call it
+        virtual void characterJoined(Character *character, unsigned int slot) {}
+
+        CharacterObserver() = default;
+        CharacterObserver(const CharacterObserver &) = default;
+        CharacterObserver &operator=(const CharacterObserver &) = default;
+        CharacterObserver(CharacterObserver &&) noexcept = default;
+        CharacterObserver &operator=(CharacterObserver &&) noexcept = default;
+        virtual ~CharacterObserver() = default;
+    };
+
     class Character
     {
         Point position;
         int health;
-        std::string name;
+        NameTable::Id name;
         bool inTeam = false, leader = false;
+        CharacterKind kind = CharacterKind::Character;
+        CharacterObserver *observer = nullptr;
 
     public:
-        Character(std::string name = "", int health = 0, Point position = Point(0, 0));
+        Character(std::string_view name = "", int health = 0, Point position = Point(0, 0));
+        CharacterKind whatKind() const;
+        bool isCowboy() const;
+        bool isNinja() const;
         bool isAlive() const;
         double distance(const Character *character) const;
+
+        // Squared distance to another character (no sqrt)
+        double squaredDistance(const Character *character) const;
         void hit(int damage);
-        std::string getName() const;
+        // Get the name of the character (stored once in the name table, valid as long as the program runs)
+        std::string_view getName() const;
         Point getLocation() const;
-        virtual std::string print() const;
+        std::string print() const;
+
+        // Append the description of the character to a buffer (without colour codes if colour is false)
+        virtual void printTo(std::string &out, bool colour = true) const;
         void addLocation(Point point);
         int whatHealth() const;
         void allowTeam();
         void setLeader();
         bool isInTeam() const;
         bool isLeader() const;
+        void setObserver(CharacterObserver *observer);
 
-        Character(const Character &) = default;
-        Character &operator=(const Character &) = default;
-        Character(Character &&) noexcept = default;
-        Character &operator=(Character &&) noexcept = default;
+        // Copies and moves get no observer: only the registered object reports to its team
+        Character(const Character &other);
+        Character &operator=(const Character &other);
+        Character(Character &&other) noexcept;
+        Character &operator=(Character &&other) noexcept;
         virtual ~Character() = default;
         // Error handling function
         void errormsg(std::string msg) const;
 
     protected:
+        Character(std::string_view name, int health, Point position, CharacterKind kind);
+
+        // Append the stats box of a cowboy or a ninja, whose last line shows the given value
+        void printStatsTo(std::string &out, const char *title, const char *lastLabel, int lastValue, const char *bottom, bool colour) const;
         void validateDamage(int damage);
         void applyDamage(int damage);
         void validateLeader();
@@ -47,18 +118,32 @@ namespace ariel
         double calculateDistance(const Character *character) const;
     };
 
+    class SoABattle;
+
     class Cowboy : public Character
     {
         int bullets = 0;
 
+        // The structure-of-arrays engine copies the ammunition in and out
+        friend class SoABattle;
+
+        // The attack loops of the teams validate once per attack and then call the perform* functions directly
+        friend class Team;
+
     public:
-        Cowboy(std::string name, Point position);
+        Cowboy(std::string_view name, Point position);
         void shoot(Character *enemy);
         bool hasboolets() const;
+        int whatBullets() const;
         void reload();
-        std::string print() const override;
 
-        Cowboy() = default;
+        // Same actions without exceptions or error output: when the action isn't allowed nothing happens
+        // and the reason is returned
+        [[nodiscard]] ActionError tryShoot(Character *enemy);
+        [[nodiscard]] ActionError tryReload();
+        void printTo(std::string &out, bool colour = true) const override;
+
+        Cowboy();
         Cowboy(const Cowboy &) = default;
         Cowboy &operator=(const Cowboy &) = default;
         Cowboy(Cowboy &&) noexcept = default;
@@ -66,6 +151,7 @@ namespace ariel
         ~Cowboy() override = default;
 
     private:
+        ActionError checkShoot(const Character *enemy) const;
         void validateShootTarget(Character *enemy);
         void performShootAction(Character *enemy);
         void validateReload();
@@ -80,20 +166,36 @@ namespace ariel
     {
         int speed = 0;
 
+        friend class SoABattle;
+        friend class Team;
+
     public:
-        Ninja(std::string name, int health, Point position, int speed = 0);
+        Ninja(std::string_view name, int health, Point position, int speed = 0);
         void move(Character *enemy);
         void slash(Character *enemy);
-        std::string print() const override;
+        int whatSpeed() const;
+
+        // Same actions without exceptions or error output (see Cowboy::tryShoot)
+        [[nodiscard]] ActionError tryMove(Character *enemy);
+        [[nodiscard]] ActionError trySlash(Character *enemy);
+
+        // Check if an enemy is close enough to be slashed (compares squared distances)
+        bool inSlashRange(const Character *enemy) const;
+        void printTo(std::string &out, bool colour = true) const override;
 
-        Ninja() = default;
+        Ninja();
         Ninja(const Ninja &) = default;
         Ninja &operator=(const Ninja &) = default;
         Ninja(Ninja &&) noexcept = default;
         Ninja &operator=(Ninja &&) noexcept = default;
         ~Ninja() override = default;
 
+    protected:
+        Ninja(std::string_view name, int health, Point position, int speed, CharacterKind kind);
+
     private:
+        ActionError checkMove(const Character *enemy) const;
+        ActionError checkSlash(const Character *enemy) const;
         void validateMove(Character *enemy);
         void performMove(Character *enemy);
         void validateEnemyNotNull(Character *enemy);
@@ -101,14 +203,18 @@ namespace ariel
         void validateAlive();
         void validateEnemyAlive(Character *enemy);
         void performSlash(Character *enemy);
+
+        // Same actions with the stats given by the caller (the attack kernels of the teams pass constants)
+        void performMove(Character *enemy, double distance);
+        void performSlash(Character *enemy, int damage);
     };
 
     class YoungNinja : public Ninja
     {
     public:
-        YoungNinja(std::string name, Point position);
+        YoungNinja(std::string_view name, Point position);
 
-        YoungNinja() = default;
+        YoungNinja();
         YoungNinja(const YoungNinja &) = default;
         YoungNinja &operator=(const YoungNinja &) = default;
         YoungNinja(YoungNinja &&) noexcept = default;
@@ -119,9 +225,9 @@ namespace ariel
     class OldNinja : public Ninja
     {
     public:
-        OldNinja(std::string name, Point position);
+        OldNinja(std::string_view name, Point position);
 
-        OldNinja() = default;
+        OldNinja();
         OldNinja(const OldNinja &) = default;
         OldNinja &operator=(const OldNinja &) = default;
         OldNinja(OldNinja &&) noexcept = default;
@@ -132,9 +238,9 @@ namespace ariel
     class TrainedNinja : public Ninja
     {
     public:
-        TrainedNinja(std::string name, Point position);
+        TrainedNinja(std::string_view name, Point position);
 
-        TrainedNinja() = default;
+        TrainedNinja();
         TrainedNinja(const TrainedNinja &) = default;
         TrainedNinja &operator=(const TrainedNinja &) = default;
         TrainedNinja(TrainedNinja &&) noexcept = default;
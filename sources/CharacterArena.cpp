@@ -0,0 +1,103 @@
+#include "CharacterArena.hpp"
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    const size_t DEFAULT_BLOCK_SIZE = 4096;
+
+    size_t alignUp(size_t offset, size_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+CharacterArena::CharacterArena(size_t blockSize) : blockSize(blockSize == 0 ? DEFAULT_BLOCK_SIZE : blockSize) {}
+
+CharacterArena::CharacterArena(CharacterArena &&other) noexcept : blocks(other.blocks), used(other.used), blockSize(other.blockSize)
+{
+    other.blocks = nullptr;
+    other.used = 0;
+}
+
+CharacterArena &CharacterArena::operator=(CharacterArena &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        blocks = exchange(other.blocks, nullptr);
+        used = exchange(other.used, 0);
+        blockSize = other.blockSize;
+    }
+    return *this;
+}
+
+CharacterArena::~CharacterArena()
+{
+    release();
+}
+
+void CharacterArena::setBlockSize(size_t blockSize)
+{
+    this->blockSize = blockSize == 0 ? DEFAULT_BLOCK_SIZE : blockSize;
+}
+
+void *CharacterArena::allocate(size_t size, size_t alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment > alignof(max_align_t))
+    {
+        throw invalid_argument("Unsupported alignment");
+    }
+    size_t offset = alignUp(used, alignment);
+    if (blocks == nullptr || offset + size > blocks->size)
+    {
+        grow(size);
+        offset = alignUp(used, alignment);
+    }
+    used = offset + size;
+    return reinterpret_cast<char *>(blocks) + offset;
+}
+
+void CharacterArena::grow(size_t minimum)
+{
+    // The header is padded so that the first object is aligned for any type
+    size_t header = alignUp(sizeof(Block), alignof(max_align_t));
+    size_t size = header + (minimum > blockSize ? minimum : blockSize);
+    Block *block = static_cast<Block *>(::operator new(size));
+    block->next = blocks;
+    block->size = size;
+    blocks = block;
+    used = header;
+
+    // Every new block is twice as large, so a team needs few of them
+    blockSize *= 2;
+}
+
+bool CharacterArena::owns(const void *object) const
+{
+    const char *address = static_cast<const char *>(object);
+    for (const Block *block = blocks; block != nullptr; block = block->next)
+    {
+        const char *begin = reinterpret_cast<const char *>(block);
+        if (address >= begin && address < begin + block->size)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CharacterArena::release()
+{
+    while (blocks != nullptr)
+    {
+        Block *next = blocks->next;
+        ::operator delete(blocks);
+        blocks = next;
+    }
+    used = 0;
+}
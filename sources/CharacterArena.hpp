@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ariel
+{
+    // Bump allocator for the members of a team. Memory is handed out from large blocks
+    // and given back all at once by release(); the objects built in it must be destroyed
+    // by their owner before that.
+    class CharacterArena
+    {
+    public:
+        // Constructor with the size of the first block (0 picks a default size)
+        explicit CharacterArena(std::size_t blockSize = 0);
+
+        CharacterArena(const CharacterArena &) = delete;
+        CharacterArena &operator=(const CharacterArena &) = delete;
+        CharacterArena(CharacterArena &&other) noexcept;
+        CharacterArena &operator=(CharacterArena &&other) noexcept;
+
+        ~CharacterArena();
+
+        // Get uninitialized memory for an object of the given size and alignment
+        void *allocate(std::size_t size, std::size_t alignment);
+
+        // Check if an object lives in the memory of the arena
+        bool owns(const void *object) const;
+
+        // Give all the blocks back (without running any destructor)
+        void release();
+
+        // Change the size of the next block to be allocated
+        void setBlockSize(std::size_t blockSize);
+
+    private:
+        // Header placed at the start of every block
+        struct Block
+        {
+            Block *next;
+            std::size_t size;
+        };
+
+        Block *blocks = nullptr;
+        std::size_t used = 0;
+        std::size_t blockSize;
+
+        void grow(std::size_t minimum);
+    };
+}
@@ -0,0 +1,80 @@
+#include "CompactUnit.hpp"
+#include "ScenarioFile.hpp"
+#include "UnitTraits.hpp"
+#include <stdexcept>
+#include <type_traits>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    static_assert(sizeof(CompactUnit) == 16, "Four compact units fit in a cache line");
+    static_assert(is_trivially_copyable<CompactUnit>::value, "Compact units are copied as raw bytes");
+}
+
+PointF CompactUnit::location() const
+{
+    return PointF(x, y);
+}
+
+void CompactUnit::setLocation(const PointF &location)
+{
+    x = location.whatX();
+    y = location.whatY();
+}
+
+bool CompactUnit::isAlive() const
+{
+    return health > 0;
+}
+
+bool CompactUnit::isCowboy() const
+{
+    return static_cast<CharacterKind>(kind) == CharacterKind::Cowboy;
+}
+
+bool CompactUnit::isLeader() const
+{
+    return (flags & LEADER) != 0;
+}
+
+CompactUnit ariel::makeCompactUnit(const Character &character, uint16_t team)
+{
+    if (!character.isCowboy() && !character.isNinja())
+    {
+        throw invalid_argument("Only cowboys and ninjas have a compact unit");
+    }
+    PointF location(character.getLocation());
+    CompactUnit unit{};
+    unit.x = location.whatX();
+    unit.y = location.whatY();
+    unit.health = static_cast<int16_t>(character.whatHealth());
+    unit.kind = static_cast<uint8_t>(character.whatKind());
+    if (character.isCowboy())
+    {
+        unit.bullets = static_cast<uint8_t>(static_cast<const Cowboy &>(character).whatBullets());
+    }
+    else
+    {
+        unit.speed = static_cast<uint8_t>(static_cast<const Ninja &>(character).whatSpeed());
+    }
+    unit.flags = character.isLeader() ? CompactUnit::LEADER : 0;
+    unit.team = team;
+    return unit;
+}
+
+CompactUnit ariel::makeCompactUnit(const ScenarioRecord &record)
+{
+    // Records are validated when their file is opened: the kind and health are known to fit
+    CharacterKind kind = static_cast<CharacterKind>(record.kind);
+    CompactUnit unit{};
+    unit.x = static_cast<float>(record.x);
+    unit.y = static_cast<float>(record.y);
+    unit.health = static_cast<int16_t>(record.health);
+    unit.kind = record.kind;
+    unit.bullets = static_cast<uint8_t>(unitTraits(kind).bullets);
+    unit.speed = static_cast<uint8_t>(unitTraits(kind).speed);
+    unit.team = record.team;
+    return unit;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "BasicPoint.hpp"
+#include "Character.hpp"
+#include <cstdint>
+
+namespace ariel
+{
+    struct ScenarioRecord;
+
+    // A unit in 16 bytes, for battles with millions of units: float coordinates
+    // and small integers, no name, no virtual functions
+    struct CompactUnit
+    {
+        float x;
+        float y;
+        std::int16_t health;
+
+        // A CharacterKind (a cowboy or one of the ninjas)
+        std::uint8_t kind;
+
+        // Ammunition of a cowboy
+        std::uint8_t bullets;
+
+        // Speed of a ninja
+        std::uint8_t speed;
+
+        // LEADER when the unit leads its team
+        std::uint8_t flags;
+
+        // Index of the team of the unit
+        std::uint16_t team;
+
+        static const std::uint8_t LEADER = 1;
+
+        // Get and set the location of the unit
+        PointF location() const;
+        void setLocation(const PointF &location);
+
+        bool isAlive() const;
+        bool isCowboy() const;
+        bool isLeader() const;
+    };
+
+    // Build the compact unit of a cowboy or a ninja of the given team
+    CompactUnit makeCompactUnit(const Character &character, std::uint16_t team);
+
+    // Build the compact unit of a unit of a scenario file (records don't mark leaders: the flags are left clear)
+    CompactUnit makeCompactUnit(const ScenarioRecord &record);
+}
@@ -0,0 +1,189 @@
+#include "FreeForAll.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace ariel;
+using namespace std;
+
+FreeForAll::FreeForAll(TurnOrder order) : order(order) {}
+
+FreeForAll::~FreeForAll()
+{
+    for (Team *team : teams)
+    {
+        team->setObserver(nullptr);
+    }
+}
+
+void FreeForAll::validateTeam(Team *team) const
+{
+    if (team == nullptr)
+    {
+        throw invalid_argument("Can't add a NULL team");
+    }
+    if (find(teams.begin(), teams.end(), team) != teams.end())
+    {
+        throw invalid_argument("The team is already in the battle");
+    }
+    if (team->observer() != nullptr)
+    {
+        throw invalid_argument("The team is already followed by another battle");
+    }
+    if (team->leader == nullptr)
+    {
+        throw invalid_argument("A team needs a leader to join a battle");
+    }
+}
+
+void FreeForAll::join(Team *team)
+{
+    validateTeam(team);
+    unsigned int first = firstSlot.back();
+    for (unsigned int slot = team->nextAlive(0); slot < team->capacity(); slot = team->nextAlive(slot + 1))
+    {
+        everyone.insert(team->characters[slot], first + slot);
+    }
+    teams.push_back(team);
+    firstSlot.push_back(first + team->capacity());
+    team->setObserver(this);
+}
+
+unsigned int FreeForAll::teamCount() const
+{
+    return static_cast<unsigned int>(teams.size());
+}
+
+Team *FreeForAll::team(unsigned int index) const
+{
+    if (index >= teams.size())
+    {
+        throw out_of_range("No such team in the battle");
+    }
+    return teams[index];
+}
+
+unsigned int FreeForAll::teamsAlive() const
+{
+    return static_cast<unsigned int>(count_if(teams.begin(), teams.end(), [](const Team *team)
+                                              { return team->stillAlive() > 0; }));
+}
+
+unsigned int FreeForAll::teamOfSlot(unsigned int slot) const
+{
+    return static_cast<unsigned int>(upper_bound(firstSlot.begin(), firstSlot.end(), slot) - firstSlot.begin() - 1);
+}
+
+int FreeForAll::targetOf(unsigned int index) const
+{
+    Team *attacker = team(index);
+    // A dead leader is replaced by the attack itself, until then its location still leads the team.
+    // Without a leader the first living member leads.
+    const Character *origin = attacker->leader;
+    if (origin == nullptr)
+    {
+        unsigned int first = attacker->nextAlive(0);
+        if (first >= attacker->capacity())
+        {
+            return -1;
+        }
+        origin = attacker->characters[first];
+    }
+    unsigned int slot = everyone.nearestSlotOutside(origin->getLocation(), firstSlot[index], firstSlot[index + 1], attacker->distanceMode());
+    if (slot == SpatialGrid::NO_SLOT)
+    {
+        return -1;
+    }
+    return static_cast<int>(teamOfSlot(slot));
+}
+
+bool FreeForAll::attackTarget(unsigned int attacker, int target)
+{
+    if (teams[attacker]->stillAlive() == 0)
+    {
+        return false;
+    }
+    if (target < 0 || teams[static_cast<unsigned int>(target)]->stillAlive() == 0)
+    {
+        target = targetOf(attacker);
+        if (target < 0)
+        {
+            return false;
+        }
+    }
+    teams[attacker]->attack(teams[static_cast<unsigned int>(target)]);
+    return true;
+}
+
+unsigned int FreeForAll::round()
+{
+    TraceScope trace("round");
+    vector<int> targets(teams.size(), -1);
+    if (order == TurnOrder::Simultaneous)
+    {
+        for (unsigned int index = 0; index < teams.size(); index++)
+        {
+            if (teams[index]->stillAlive() > 0)
+            {
+                targets[index] = targetOf(index);
+            }
+        }
+    }
+
+    unsigned int attacks = 0;
+    for (unsigned int index = 0; index < teams.size(); index++)
+    {
+        if (attackTarget(index, targets[index]))
+        {
+            attacks++;
+        }
+    }
+    played++;
+    return attacks;
+}
+
+int FreeForAll::fight(unsigned int maxRounds)
+{
+    for (unsigned int count = 0; count < maxRounds && teamsAlive() > 1; count++)
+    {
+        round();
+    }
+    if (teamsAlive() != 1)
+    {
+        return -1;
+    }
+    return static_cast<int>(find_if(teams.begin(), teams.end(), [](const Team *team)
+                                    { return team->stillAlive() > 0; }) -
+                            teams.begin());
+}
+
+unsigned int FreeForAll::rounds() const
+{
+    return played;
+}
+
+void FreeForAll::characterMoved(Character *character, const Point &from)
+{
+    everyone.move(character, from, character->getLocation());
+}
+
+void FreeForAll::characterHit(Character *)
+{
+}
+
+void FreeForAll::characterDied(Character *character)
+{
+    everyone.remove(character, character->getLocation());
+}
+
+void FreeForAll::characterJoined(Character *character, unsigned int slot)
+{
+    for (unsigned int index = 0; index < teams.size(); index++)
+    {
+        if (teams[index]->inTeam(character))
+        {
+            everyone.insert(character, firstSlot[index] + slot);
+            return;
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Team.hpp"
+#include "SpatialGrid.hpp"
+#include <vector>
+
+namespace ariel
+{
+    // When the teams of a free-for-all pick the team they attack
+    enum class TurnOrder : unsigned char
+    {
+        // Every team picks its target right before its own attack
+        Alternating,
+
+        // Every team picks its target at the start of the round, before anyone attacks
+        // (a team whose target was wiped out in the meantime picks again)
+        Simultaneous
+    };
+
+    // Battle between any number of teams. Each round every team that still stands attacks once,
+    // in the order the teams joined, with its own attack rules (Team, Team2, SmartTeam, ...).
+    // The target team is the one with the living enemy closest to the attacker's leader, found
+    // in a spatial index shared by all the teams.
+    class FreeForAll : public CharacterObserver
+    {
+    public:
+        // Constructor with the order of the turns
+        explicit FreeForAll(TurnOrder order = TurnOrder::Alternating);
+
+        // The teams report to the battle, so it can't be copied or moved
+        FreeForAll(const FreeForAll &) = delete;
+        FreeForAll &operator=(const FreeForAll &) = delete;
+        FreeForAll(FreeForAll &&) = delete;
+        FreeForAll &operator=(FreeForAll &&) = delete;
+
+        // Stop following the teams
+        ~FreeForAll() override;
+
+        // Add a team with all its members (not owned, it must outlive the battle)
+        void join(Team *team);
+
+        // Number of teams in the battle
+        unsigned int teamCount() const;
+
+        // Get a team of the battle
+        Team *team(unsigned int index) const;
+
+        // Number of teams that still have living members
+        unsigned int teamsAlive() const;
+
+        // Get the team the given team would attack now (-1 when no other team stands)
+        int targetOf(unsigned int index) const;
+
+        // Play one round, returns the number of attacks
+        unsigned int round();
+
+        // Fight until at most one team stands. Returns the index of the winner, or -1 for a draw
+        // (no team left, or maxRounds rounds played).
+        int fight(unsigned int maxRounds = 1000);
+
+        // Number of rounds played
+        unsigned int rounds() const;
+
+        // Keep the shared index up to date
+        void characterMoved(Character *character, const Point &from) override;
+        void characterHit(Character *character) override;
+        void characterDied(Character *character) override;
+
+        // Add a member that joined one of the teams after the team joined the battle
+        void characterJoined(Character *character, unsigned int slot) override;
+
+    private:
+        TurnOrder order;
+        std::vector<Team *> teams;
+
+        // First slot of every team in the shared index, followed by the number of slots
+        std::vector<unsigned int> firstSlot{0};
+
+        // Living members of all the teams, a member's slot is the first slot of its team plus its slot in the team
+        SpatialGrid everyone;
+
+        unsigned int played = 0;
+
+        void validateTeam(Team *team) const;
+        unsigned int teamOfSlot(unsigned int slot) const;
+        bool attackTarget(unsigned int attacker, int target);
+    };
+}
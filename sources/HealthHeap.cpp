@@ -0,0 +1,83 @@
+#include "HealthHeap.hpp"
+#include <algorithm>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    // Outdated entries allowed per tracked member before the heap is rebuilt
+    const size_t REBUILD_FACTOR = 2;
+    const size_t MIN_REBUILD_SIZE = 64;
+}
+
+bool HealthHeap::after(const Entry &first, const Entry &second)
+{
+    // std heaps keep the largest element on top, so the order is reversed
+    return first.health != second.health ? first.health > second.health : first.slot > second.slot;
+}
+
+bool HealthHeap::outdated(const Entry &entry) const
+{
+    return current[entry.slot] != entry.health;
+}
+
+void HealthHeap::update(unsigned int slot, int health)
+{
+    if (current.size() <= slot)
+    {
+        current.resize(slot + 1, -1);
+    }
+    if (current[slot] == health)
+    {
+        return;
+    }
+    if (current[slot] < 0)
+    {
+        tracked++;
+    }
+    current[slot] = health;
+    heap.push_back(Entry{health, slot});
+    push_heap(heap.begin(), heap.end(), after);
+    if (heap.size() > max(MIN_REBUILD_SIZE, REBUILD_FACTOR * tracked))
+    {
+        rebuild();
+    }
+}
+
+void HealthHeap::remove(unsigned int slot)
+{
+    if (slot < current.size() && current[slot] >= 0)
+    {
+        current[slot] = -1;
+        tracked--;
+    }
+}
+
+unsigned int HealthHeap::weakest()
+{
+    while (!heap.empty() && outdated(heap.front()))
+    {
+        pop_heap(heap.begin(), heap.end(), after);
+        heap.pop_back();
+    }
+    return heap.empty() ? NO_SLOT : heap.front().slot;
+}
+
+unsigned int HealthHeap::size() const
+{
+    return tracked;
+}
+
+void HealthHeap::rebuild()
+{
+    heap.clear();
+    for (unsigned int slot = 0; slot < current.size(); slot++)
+    {
+        if (current[slot] >= 0)
+        {
+            heap.push_back(Entry{current[slot], slot});
+        }
+    }
+    make_heap(heap.begin(), heap.end(), after);
+}
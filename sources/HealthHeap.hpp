@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+namespace ariel
+{
+    // Min-heap of the health of the living members of a team, for the weakest member queries.
+    // Updates push a new entry and leave the old one behind; outdated entries are dropped
+    // when they reach the top, and the heap is rebuilt when they pile up.
+    class HealthHeap
+    {
+    public:
+        // Index returned by weakest() when no member is tracked
+        static const unsigned int NO_SLOT = ~0U;
+
+        // Track the member in the given slot with its current health (also used after it was hit)
+        void update(unsigned int slot, int health);
+
+        // Stop tracking the member in the given slot
+        void remove(unsigned int slot);
+
+        // Get the slot of the member with the least health, the first slot wins on ties (NO_SLOT when empty)
+        unsigned int weakest();
+
+        // Number of tracked members
+        unsigned int size() const;
+
+    private:
+        struct Entry
+        {
+            int health;
+            unsigned int slot;
+        };
+
+        // Entries ordered by health, then by slot
+        std::vector<Entry> heap;
+
+        // Current health of every slot, -1 for slots that aren't tracked
+        std::vector<int> current;
+        unsigned int tracked = 0;
+
+        static bool after(const Entry &first, const Entry &second);
+        bool outdated(const Entry &entry) const;
+        void rebuild();
+    };
+}
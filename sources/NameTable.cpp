@@ -0,0 +1,63 @@
+#include "NameTable.hpp"
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+using namespace ariel;
+using namespace std;
+
+NameTable &NameTable::global()
+{
+    static NameTable table;
+    return table;
+}
+
+NameTable::NameTable()
+{
+    names.emplace_back();
+    ids.emplace(names.back(), Id{EMPTY});
+}
+
+NameTable::Id NameTable::intern(string_view name)
+{
+    {
+        shared_lock<shared_mutex> reading(lock);
+        auto found = ids.find(name);
+        if (found != ids.end())
+        {
+            return found->second;
+        }
+    }
+
+    unique_lock<shared_mutex> writing(lock);
+    // Another thread may have added it in the meantime
+    auto found = ids.find(name);
+    if (found != ids.end())
+    {
+        return found->second;
+    }
+    if (names.size() > numeric_limits<Id>::max())
+    {
+        throw length_error("Too many character names");
+    }
+    Id id = static_cast<Id>(names.size());
+    names.emplace_back(name);
+    ids.emplace(names.back(), id);
+    return id;
+}
+
+string_view NameTable::name(Id id) const
+{
+    shared_lock<shared_mutex> reading(lock);
+    if (id >= names.size())
+    {
+        throw out_of_range("Unknown name id");
+    }
+    return names[id];
+}
+
+size_t NameTable::size() const
+{
+    shared_lock<shared_mutex> reading(lock);
+    return names.size();
+}
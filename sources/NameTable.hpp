@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace ariel
+{
+    // Table of the names of the characters. Every distinct name is stored once and
+    // characters only keep its id. Names are never removed, so the views stay valid.
+    // Safe to use from several threads (e.g. the battles of a tournament).
+    class NameTable
+    {
+    public:
+        using Id = std::uint32_t;
+
+        // Id of the empty name
+        static const Id EMPTY = 0;
+
+        // The table shared by all the characters
+        static NameTable &global();
+
+        NameTable();
+
+        NameTable(const NameTable &) = delete;
+        NameTable &operator=(const NameTable &) = delete;
+        NameTable(NameTable &&) = delete;
+        NameTable &operator=(NameTable &&) = delete;
+        ~NameTable() = default;
+
+        // Get the id of a name, adding it to the table the first time
+        Id intern(std::string_view name);
+
+        // Get the name of an id
+        std::string_view name(Id id) const;
+
+        // Number of distinct names
+        std::size_t size() const;
+
+    private:
+        mutable std::shared_mutex lock;
+
+        // A deque never moves its elements, so the views of the index stay valid
+        std::deque<std::string> names;
+        std::unordered_map<std::string_view, Id> ids;
+    };
+}
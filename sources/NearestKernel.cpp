@@ -0,0 +1,303 @@
+#include "NearestKernel.hpp"
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NEAREST_KERNEL_X86
+#endif
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    // Above this truncated distance (b + 1)^2 is no longer exact and the scalar scan is used
+    const double MAX_EXACT_DISTANCE = 67108864.0; // 2^26
+
+    // Squared distance computed exactly like Point::distance does before its sqrt
+    inline double squaredDistance(const double *xs, const double *ys, size_t index, double originX, double originY)
+    {
+        double dx = originX - xs[index];
+        double dy = originY - ys[index];
+        return dx * dx + dy * dy;
+    }
+
+    inline int truncatedDistance(double squared)
+    {
+        return static_cast<int>(sqrt(squared));
+    }
+
+    // Reference implementation: the loop of Team::CloseCharacter
+    size_t nearestScalar(const double *xs, const double *ys, size_t count, double originX, double originY)
+    {
+        size_t closest = count;
+        int minDistance = numeric_limits<int>::max();
+        for (size_t i = 0; i < count; i++)
+        {
+            int distance = truncatedDistance(squaredDistance(xs, ys, i, originX, originY));
+            if (distance < minDistance)
+            {
+                minDistance = distance;
+                closest = i;
+            }
+        }
+        return closest;
+    }
+
+    size_t nearestSquaredScalar(const double *xs, const double *ys, size_t count, double originX, double originY)
+    {
+        size_t closest = count;
+        double minSquared = numeric_limits<double>::infinity();
+        for (size_t i = 0; i < count; i++)
+        {
+            double squared = squaredDistance(xs, ys, i, originX, originY);
+            if (squared < minSquared || closest == count)
+            {
+                minSquared = squared;
+                closest = i;
+            }
+        }
+        return closest;
+    }
+
+    // Lanes that pass the squared limit still need the exact truncated comparison
+    inline bool matches(const double *xs, const double *ys, size_t index, double originX, double originY, int best)
+    {
+        return truncatedDistance(squaredDistance(xs, ys, index, originX, originY)) == best;
+    }
+
+    size_t firstMatchScalar(const double *xs, const double *ys, size_t begin, size_t count, double originX, double originY, double limit, int best)
+    {
+        for (size_t i = begin; i < count; i++)
+        {
+            if (squaredDistance(xs, ys, i, originX, originY) < limit && matches(xs, ys, i, originX, originY, best))
+            {
+                return i;
+            }
+        }
+        return count;
+    }
+
+#ifdef NEAREST_KERNEL_X86
+    double minSquaredSse2(const double *xs, const double *ys, size_t count, double originX, double originY, size_t &done)
+    {
+        __m128d ox = _mm_set1_pd(originX);
+        __m128d oy = _mm_set1_pd(originY);
+        __m128d best = _mm_set1_pd(numeric_limits<double>::infinity());
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m128d dx = _mm_sub_pd(ox, _mm_loadu_pd(xs + i));
+            __m128d dy = _mm_sub_pd(oy, _mm_loadu_pd(ys + i));
+            best = _mm_min_pd(best, _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+        }
+        alignas(16) double lanes[2];
+        _mm_store_pd(lanes, best);
+        done = i;
+        return lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+    }
+
+    size_t firstMatchSse2(const double *xs, const double *ys, size_t count, double originX, double originY, double limit, int best)
+    {
+        __m128d ox = _mm_set1_pd(originX);
+        __m128d oy = _mm_set1_pd(originY);
+        __m128d bound = _mm_set1_pd(limit);
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m128d dx = _mm_sub_pd(ox, _mm_loadu_pd(xs + i));
+            __m128d dy = _mm_sub_pd(oy, _mm_loadu_pd(ys + i));
+            unsigned int mask = static_cast<unsigned int>(_mm_movemask_pd(_mm_cmplt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), bound)));
+            for (size_t lane = 0; mask != 0; lane++, mask >>= 1)
+            {
+                if ((mask & 1) != 0 && matches(xs, ys, i + lane, originX, originY, best))
+                {
+                    return i + lane;
+                }
+            }
+        }
+        return firstMatchScalar(xs, ys, i, count, originX, originY, limit, best);
+    }
+
+    // First index whose squared distance is exactly the given minimum
+    size_t firstEqualSse2(const double *xs, const double *ys, size_t count, double originX, double originY, double minSquared)
+    {
+        __m128d ox = _mm_set1_pd(originX);
+        __m128d oy = _mm_set1_pd(originY);
+        __m128d target = _mm_set1_pd(minSquared);
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m128d dx = _mm_sub_pd(ox, _mm_loadu_pd(xs + i));
+            __m128d dy = _mm_sub_pd(oy, _mm_loadu_pd(ys + i));
+            int mask = _mm_movemask_pd(_mm_cmpeq_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), target));
+            if (mask != 0)
+            {
+                return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned int>(mask)));
+            }
+        }
+        for (; i < count; i++)
+        {
+            if (squaredDistance(xs, ys, i, originX, originY) == minSquared)
+            {
+                return i;
+            }
+        }
+        return count;
+    }
+
+    __attribute__((target("avx2"))) double minSquaredAvx2(const double *xs, const double *ys, size_t count, double originX, double originY, size_t &done)
+    {
+        __m256d ox = _mm256_set1_pd(originX);
+        __m256d oy = _mm256_set1_pd(originY);
+        __m256d best = _mm256_set1_pd(numeric_limits<double>::infinity());
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256d dx = _mm256_sub_pd(ox, _mm256_loadu_pd(xs + i));
+            __m256d dy = _mm256_sub_pd(oy, _mm256_loadu_pd(ys + i));
+            best = _mm256_min_pd(best, _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, best);
+        done = i;
+        double result = lanes[0];
+        for (double lane : lanes)
+        {
+            result = lane < result ? lane : result;
+        }
+        return result;
+    }
+
+    __attribute__((target("avx2"))) size_t firstMatchAvx2(const double *xs, const double *ys, size_t count, double originX, double originY, double limit, int best)
+    {
+        __m256d ox = _mm256_set1_pd(originX);
+        __m256d oy = _mm256_set1_pd(originY);
+        __m256d bound = _mm256_set1_pd(limit);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256d dx = _mm256_sub_pd(ox, _mm256_loadu_pd(xs + i));
+            __m256d dy = _mm256_sub_pd(oy, _mm256_loadu_pd(ys + i));
+            __m256d squared = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+            unsigned int mask = static_cast<unsigned int>(_mm256_movemask_pd(_mm256_cmp_pd(squared, bound, _CMP_LT_OQ)));
+            for (size_t lane = 0; mask != 0; lane++, mask >>= 1)
+            {
+                if ((mask & 1) != 0 && matches(xs, ys, i + lane, originX, originY, best))
+                {
+                    return i + lane;
+                }
+            }
+        }
+        return firstMatchScalar(xs, ys, i, count, originX, originY, limit, best);
+    }
+
+    __attribute__((target("avx2"))) size_t firstEqualAvx2(const double *xs, const double *ys, size_t count, double originX, double originY, double minSquared)
+    {
+        __m256d ox = _mm256_set1_pd(originX);
+        __m256d oy = _mm256_set1_pd(originY);
+        __m256d target = _mm256_set1_pd(minSquared);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256d dx = _mm256_sub_pd(ox, _mm256_loadu_pd(xs + i));
+            __m256d dy = _mm256_sub_pd(oy, _mm256_loadu_pd(ys + i));
+            __m256d squared = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+            int mask = _mm256_movemask_pd(_mm256_cmp_pd(squared, target, _CMP_EQ_OQ));
+            if (mask != 0)
+            {
+                return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned int>(mask)));
+            }
+        }
+        for (; i < count; i++)
+        {
+            if (squaredDistance(xs, ys, i, originX, originY) == minSquared)
+            {
+                return i;
+            }
+        }
+        return count;
+    }
+#endif
+}
+
+SimdLevel ariel::bestSimdLevel()
+{
+#ifdef NEAREST_KERNEL_X86
+    static const SimdLevel level = __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE2;
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+size_t ariel::nearestIndex(const double *xs, const double *ys, size_t count, double originX, double originY)
+{
+    return nearestIndex(xs, ys, count, originX, originY, bestSimdLevel());
+}
+
+size_t ariel::nearestIndex(const double *xs, const double *ys, size_t count, double originX, double originY, SimdLevel level)
+{
+    if (level > bestSimdLevel())
+    {
+        level = bestSimdLevel();
+    }
+    if (level == SimdLevel::Scalar || count < 4)
+    {
+        return nearestScalar(xs, ys, count, originX, originY);
+    }
+
+#ifdef NEAREST_KERNEL_X86
+    // First pass: the smallest squared distance, no sqrt per point
+    size_t done = 0;
+    double minSquared = level == SimdLevel::AVX2 ? minSquaredAvx2(xs, ys, count, originX, originY, done)
+                                                 : minSquaredSse2(xs, ys, count, originX, originY, done);
+    for (size_t i = done; i < count; i++)
+    {
+        double squared = squaredDistance(xs, ys, i, originX, originY);
+        minSquared = squared < minSquared ? squared : minSquared;
+    }
+    if (!(sqrt(minSquared) < MAX_EXACT_DISTANCE))
+    {
+        return nearestScalar(xs, ys, count, originX, originY);
+    }
+
+    // Truncation is monotonic, so the best truncated distance is the one of the smallest square.
+    // Every point with that truncated distance has a square below (best + 1)^2.
+    int best = truncatedDistance(minSquared);
+    double limit = (best + 1.0) * (best + 1.0);
+    return level == SimdLevel::AVX2 ? firstMatchAvx2(xs, ys, count, originX, originY, limit, best)
+                                    : firstMatchSse2(xs, ys, count, originX, originY, limit, best);
+#else
+    return nearestScalar(xs, ys, count, originX, originY);
+#endif
+}
+
+size_t ariel::nearestSquaredIndex(const double *xs, const double *ys, size_t count, double originX, double originY)
+{
+    SimdLevel level = bestSimdLevel();
+    if (level == SimdLevel::Scalar || count < 4)
+    {
+        return nearestSquaredScalar(xs, ys, count, originX, originY);
+    }
+
+#ifdef NEAREST_KERNEL_X86
+    size_t done = 0;
+    double minSquared = level == SimdLevel::AVX2 ? minSquaredAvx2(xs, ys, count, originX, originY, done)
+                                                 : minSquaredSse2(xs, ys, count, originX, originY, done);
+    for (size_t i = done; i < count; i++)
+    {
+        double squared = squaredDistance(xs, ys, i, originX, originY);
+        minSquared = squared < minSquared ? squared : minSquared;
+    }
+    // The first point that reaches the minimum (every lane computes squares with the same rounding)
+    size_t index = level == SimdLevel::AVX2 ? firstEqualAvx2(xs, ys, count, originX, originY, minSquared)
+                                            : firstEqualSse2(xs, ys, count, originX, originY, minSquared);
+    if (index < count)
+    {
+        return index;
+    }
+#endif
+    return nearestSquaredScalar(xs, ys, count, originX, originY);
+}
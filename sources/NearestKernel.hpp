@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ariel
+{
+    // Instruction sets the nearest point kernel can run on
+    enum class SimdLevel : unsigned char
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // Best instruction set supported by the running CPU
+    SimdLevel bestSimdLevel();
+
+    // Get the index of the first point whose distance from the origin, truncated to int, is the smallest
+    // (the choice of Team::CloseCharacter). The coordinates are contiguous arrays of count values.
+    // Returns count when there are no points.
+    std::size_t nearestIndex(const double *xs, const double *ys, std::size_t count, double originX, double originY);
+
+    // Same search on an explicit instruction set (falls back to a lower one when not supported)
+    std::size_t nearestIndex(const double *xs, const double *ys, std::size_t count, double originX, double originY, SimdLevel level);
+
+    // Get the index of the first point with the smallest squared distance from the origin, without any sqrt.
+    // Returns count when there are no points.
+    std::size_t nearestSquaredIndex(const double *xs, const double *ys, std::size_t count, double originX, double originY);
+}
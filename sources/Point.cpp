@@ -1,30 +1,111 @@
 #include "Point.hpp"
+#include "TextFormat.hpp"
+#include "NearestKernel.hpp"
 #include <string>
 #include <cmath>
 #include <stdexcept>
-#include <iomanip>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define POINT_MOVE_X86
+#endif
 
 using namespace ariel;
 using namespace std;
 
+namespace
+{
+    // Largest square whose sqrt still rounds to at most 1: sqrt(1 + 2^-52) rounds down to 1
+    const double UNIT_DISTANCE_SQUARED = 1.0000000000000002;
+
+#ifdef POINT_MOVE_X86
+    // sqrt and division are correctly rounded in every lane, so the lanes match the scalar kernel bit for bit.
+    // Lanes that arrive select the target, which also hides the 0 / 0 of a point already on its target.
+    size_t moveTowardsSse2(double *xs, double *ys, const double *targetXs, const double *targetYs, const double *dists, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m128d x = _mm_loadu_pd(xs + i);
+            __m128d y = _mm_loadu_pd(ys + i);
+            __m128d targetX = _mm_loadu_pd(targetXs + i);
+            __m128d targetY = _mm_loadu_pd(targetYs + i);
+            __m128d dist = _mm_loadu_pd(dists + i);
+            __m128d dx = _mm_sub_pd(targetX, x);
+            __m128d dy = _mm_sub_pd(targetY, y);
+            __m128d d = _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+            __m128d ratio = _mm_div_pd(dist, d);
+            __m128d arrive = _mm_cmple_pd(d, dist);
+            __m128d movedX = _mm_add_pd(x, _mm_mul_pd(dx, ratio));
+            __m128d movedY = _mm_add_pd(y, _mm_mul_pd(dy, ratio));
+            _mm_storeu_pd(xs + i, _mm_or_pd(_mm_and_pd(arrive, targetX), _mm_andnot_pd(arrive, movedX)));
+            _mm_storeu_pd(ys + i, _mm_or_pd(_mm_and_pd(arrive, targetY), _mm_andnot_pd(arrive, movedY)));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2"))) size_t moveTowardsAvx2(double *xs, double *ys, const double *targetXs, const double *targetYs, const double *dists, size_t count)
+    {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256d x = _mm256_loadu_pd(xs + i);
+            __m256d y = _mm256_loadu_pd(ys + i);
+            __m256d targetX = _mm256_loadu_pd(targetXs + i);
+            __m256d targetY = _mm256_loadu_pd(targetYs + i);
+            __m256d dist = _mm256_loadu_pd(dists + i);
+            __m256d dx = _mm256_sub_pd(targetX, x);
+            __m256d dy = _mm256_sub_pd(targetY, y);
+            __m256d d = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+            __m256d ratio = _mm256_div_pd(dist, d);
+            __m256d arrive = _mm256_cmp_pd(d, dist, _CMP_LE_OQ);
+            __m256d movedX = _mm256_add_pd(x, _mm256_mul_pd(dx, ratio));
+            __m256d movedY = _mm256_add_pd(y, _mm256_mul_pd(dy, ratio));
+            _mm256_storeu_pd(xs + i, _mm256_blendv_pd(movedX, targetX, arrive));
+            _mm256_storeu_pd(ys + i, _mm256_blendv_pd(movedY, targetY, arrive));
+        }
+        return i;
+    }
+#endif
+}
+
 Point::Point(double P_x, double P_y) : P_x(P_x), P_y(P_y){};
 
 double Point::distance(const Point &p) const
+{
+    // Calculate the Euclidean distance
+    return sqrt(squaredDistance(p));
+}
+
+double Point::squaredDistance(const Point &p) const
 {
     // Calculate the differences in x and y coordinates
     double dx = P_x - p.whatX();
     double dy = P_y - p.whatY();
+    return dx * dx + dy * dy;
+}
 
-    // Calculate the Euclidean distance
-    return sqrt(dx * dx + dy * dy);
+bool Point::withinUnitDistance(const Point &p) const
+{
+    return squaredDistance(p) <= UNIT_DISTANCE_SQUARED;
 }
 std::string Point::print() const
 {
-    // Format the point coordinates as a string
-    std::ostringstream out;
-    out << "\033[1;33m" << std::fixed << std::setprecision(3) << "(" << P_x << ", " << P_y << ")"
-        << "\033[0m";
-    return out.str();
+    std::string out;
+    printTo(out);
+    return out;
+}
+
+void Point::printTo(std::string &out, bool colour) const
+{
+    // Format the point coordinates with three decimals
+    appendColour(out, colour::YELLOW, colour);
+    out += '(';
+    appendFixed(out, P_x, 3);
+    out += ", ";
+    appendFixed(out, P_y, 3);
+    out += ')';
+    appendColour(out, colour::RESET, colour);
 }
 
 double Point::whatX() const
@@ -45,15 +126,27 @@ void Point::updateX(double P_x)
 Point Point::moveTowards(const Point &point1, const Point &point2, double dist)
 {
     validateDistance(dist);
-    if (isWithinDistance(point1, point2, dist))
+    double x = point1.P_x;
+    double y = point1.P_y;
+    moveCoordinates(x, y, point2.P_x, point2.P_y, dist);
+    return Point(x, y);
+}
+
+void Point::moveTowards(double *xs, double *ys, const double *targetXs, const double *targetYs, const double *dists, size_t count)
+{
+    // Check everything first, so that nothing moves when a distance is invalid
+    for (size_t i = 0; i < count; i++)
     {
-        return point2;
+        validateDistance(dists[i]);
     }
-    else
+    size_t done = 0;
+#ifdef POINT_MOVE_X86
+    done = bestSimdLevel() == SimdLevel::AVX2 ? moveTowardsAvx2(xs, ys, targetXs, targetYs, dists, count)
+                                              : moveTowardsSse2(xs, ys, targetXs, targetYs, dists, count);
+#endif
+    for (size_t i = done; i < count; i++)
     {
-        double new_x = calculateNewX(point1, point2, dist);
-        double new_y = calculateNewY(point1, point2, dist);
-        return createNewPoint(new_x, new_y);
+        moveCoordinates(xs[i], ys[i], targetXs[i], targetYs[i], dists[i]);
     }
 }
 void Point::updateY(double P_y)
@@ -69,31 +162,21 @@ void Point::validateDistance(double dist)
     }
 }
 
-bool Point::isWithinDistance(const Point &point1, const Point &point2, double dist)
+void Point::moveCoordinates(double &x, double &y, double targetX, double targetY, double dist)
 {
-    double d = point1.distance(point2);
-    return (d <= dist);
-}
-
-double Point::calculateNewX(const Point &point1, const Point &point2, double dist)
-{
-    double dx = point2.whatX() - point1.whatX();
-    double d = point1.distance(point2);
-    double ratio = dist / d;
-    return point1.whatX() + dx * ratio;
-}
-
-double Point::calculateNewY(const Point &point1, const Point &point2, double dist)
-{
-    double dy = point2.whatY() - point1.whatY();
-    double d = point1.distance(point2);
+    // (-dx)^2 == dx^2, so d is exactly the value distance() computes
+    double dx = targetX - x;
+    double dy = targetY - y;
+    double d = sqrt(dx * dx + dy * dy);
+    if (d <= dist)
+    {
+        x = targetX;
+        y = targetY;
+        return;
+    }
     double ratio = dist / d;
-    return point1.whatY() + dy * ratio;
-}
-
-Point Point::createNewPoint(double x_cordi, double y_cordi)
-{
-    return Point(x_cordi, y_cordi);
+    x = x + dx * ratio;
+    y = y + dy * ratio;
 }
 
 bool Point::compare(const Point &other) const
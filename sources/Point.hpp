@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 namespace ariel
@@ -16,9 +17,18 @@ namespace ariel
         // Calculate the distance between two points
         double distance(const Point &p) const;
 
+        // Calculate the squared distance between two points (no sqrt, same rounding as distance() before its sqrt)
+        double squaredDistance(const Point &p) const;
+
+        // Check if a point is at most 1 away without a sqrt (always the same answer as distance(p) <= 1)
+        bool withinUnitDistance(const Point &p) const;
+
         // Get a string representation of the point
         std::string print() const;
 
+        // Append the representation of the point to a buffer (without colour codes if colour is false)
+        void printTo(std::string &out, bool colour = true) const;
+
         // Get the x-coordinate of the point
         double whatX() const;
 
@@ -31,9 +41,13 @@ namespace ariel
         // Set the y-coordinate of the point
         void updateY(double P_y);
 
-        // Move towards a point by a specified distance
+        // Move towards a point by a specified distance (a single sqrt)
         static Point moveTowards(const Point &point1, const Point &point2, double dist);
 
+        // Move every point i of xs and ys, in place, towards (targetXs[i], targetYs[i]) by dists[i].
+        // Gives the same coordinates as moveTowards() one point at a time.
+        static void moveTowards(double *xs, double *ys, const double *targetXs, const double *targetYs, const double *dists, std::size_t count);
+
         // Compare two points and check if they are the same
         bool compare(const Point &other) const;
 
@@ -41,16 +55,7 @@ namespace ariel
         // Helper function to validate the distance parameter
         static void validateDistance(double dist);
 
-        // Helper function to check if two points are within a specified distance
-        static bool isWithinDistance(const Point &point1, const Point &point2, double dist);
-
-        // Helper function to calculate the new x-coordinate when moving towards a point
-        static double calculateNewX(const Point &point1, const Point &point2, double dist);
-
-        // Helper function to calculate the new y-coordinate when moving towards a point
-        static double calculateNewY(const Point &point1, const Point &point2, double dist);
-
-        // Helper function to create a new Point object with the given coordinates
-        static Point createNewPoint(double x, double y);
+        // Move the coordinates (x, y) towards (targetX, targetY), the kernel of both moveTowards()
+        static void moveCoordinates(double &x, double &y, double targetX, double targetY, double dist);
     };
 }
@@ -0,0 +1,318 @@
+#include "ScenarioFile.hpp"
+#include "Team.hpp"
+#include "UnitTraits.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    // File header: magic, version, size of a record and number of records
+    struct ScenarioHeader
+    {
+        char magic[4];
+        uint16_t version;
+        uint16_t recordSize;
+        uint64_t count;
+    };
+
+    const char MAGIC[4] = {'N', 'C', 'S', 'C'};
+    const uint16_t VERSION = 1;
+
+    static_assert(sizeof(ScenarioHeader) == 16, "The records start 8 byte aligned after the header");
+    static_assert(sizeof(ScenarioRecord) == 24, "Units are stored as fixed 24 byte records");
+    static_assert(is_trivially_copyable<ScenarioRecord>::value, "Units are stored as raw bytes");
+    static_assert(alignof(Cowboy) == alignof(Character) && alignof(YoungNinja) == alignof(Character) &&
+                      alignof(TrainedNinja) == alignof(Character) && alignof(OldNinja) == alignof(Character),
+                  "Every kind of character fits memory aligned for a Character");
+
+    // Health of a new character of the given kind, 0 for kinds that can't be stored
+    int initialHealth(uint8_t kind)
+    {
+        return unitTraits(static_cast<CharacterKind>(kind)).health;
+    }
+
+    // Create the character of a record (owned by the caller)
+    Character *createCharacter(const ScenarioRecord &record)
+    {
+        void *memory = ::operator new(characterSize(record));
+        try
+        {
+            return makeCharacter(record, memory);
+        }
+        catch (...)
+        {
+            ::operator delete(memory);
+            throw;
+        }
+    }
+}
+
+size_t ariel::characterSize(const ScenarioRecord &record)
+{
+    switch (static_cast<CharacterKind>(record.kind))
+    {
+    case CharacterKind::Cowboy:
+        return sizeof(Cowboy);
+    case CharacterKind::YoungNinja:
+        return sizeof(YoungNinja);
+    case CharacterKind::TrainedNinja:
+        return sizeof(TrainedNinja);
+    case CharacterKind::OldNinja:
+        return sizeof(OldNinja);
+    default:
+        throw invalid_argument("Only cowboys and ninjas can be loaded");
+    }
+}
+
+Character *ariel::makeCharacter(const ScenarioRecord &record, void *memory)
+{
+    Point location(record.x, record.y);
+    Character *character = nullptr;
+    switch (static_cast<CharacterKind>(record.kind))
+    {
+    case CharacterKind::Cowboy:
+        character = new (memory) Cowboy("Cowboy", location);
+        break;
+    case CharacterKind::YoungNinja:
+        character = new (memory) YoungNinja("YoungNinja", location);
+        break;
+    case CharacterKind::TrainedNinja:
+        character = new (memory) TrainedNinja("TrainedNinja", location);
+        break;
+    case CharacterKind::OldNinja:
+        character = new (memory) OldNinja("OldNinja", location);
+        break;
+    default:
+        throw invalid_argument("Only cowboys and ninjas can be loaded");
+    }
+    try
+    {
+        character->hit(character->whatHealth() - record.health);
+    }
+    catch (...)
+    {
+        character->~Character();
+        throw;
+    }
+    return character;
+}
+
+ScenarioRecord ariel::makeRecord(const Character &character, uint8_t team)
+{
+    if (!character.isCowboy() && !character.isNinja())
+    {
+        throw invalid_argument("Only cowboys and ninjas can be stored in a scenario");
+    }
+    Point location = character.getLocation();
+    ScenarioRecord record{};
+    record.x = location.whatX();
+    record.y = location.whatY();
+    record.health = character.whatHealth();
+    record.kind = static_cast<uint8_t>(character.whatKind());
+    record.team = team;
+    return record;
+}
+
+void ariel::saveScenario(const string &path, vector<ScenarioRecord> records)
+{
+    stable_sort(records.begin(), records.end(), [](const ScenarioRecord &first, const ScenarioRecord &second)
+                { return first.team < second.team; });
+
+    ScenarioHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.recordSize = sizeof(ScenarioRecord);
+    header.count = records.size();
+
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(records.data()), static_cast<streamsize>(records.size() * sizeof(ScenarioRecord)));
+    if (!out)
+    {
+        throw runtime_error("Can't write " + path);
+    }
+}
+
+MappedScenario::MappedScenario(const string &path)
+{
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        throw runtime_error("Can't open " + path);
+    }
+    struct stat status{};
+    if (fstat(file, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(ScenarioHeader)))
+    {
+        close(file);
+        throw runtime_error("Not a scenario file: " + path);
+    }
+    bytes = static_cast<size_t>(status.st_size);
+    memory = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (memory == MAP_FAILED)
+    {
+        memory = nullptr;
+        throw runtime_error("Can't map " + path);
+    }
+    madvise(memory, bytes, MADV_SEQUENTIAL);
+
+    try
+    {
+        validate();
+        indexTeams();
+    }
+    catch (...)
+    {
+        unmap();
+        throw;
+    }
+}
+
+MappedScenario::MappedScenario(MappedScenario &&other) noexcept
+    : memory(exchange(other.memory, nullptr)), bytes(exchange(other.bytes, 0)),
+      records(exchange(other.records, nullptr)), count(exchange(other.count, 0)), teamStart(move(other.teamStart))
+{
+}
+
+MappedScenario &MappedScenario::operator=(MappedScenario &&other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        memory = exchange(other.memory, nullptr);
+        bytes = exchange(other.bytes, 0);
+        records = exchange(other.records, nullptr);
+        count = exchange(other.count, 0);
+        teamStart = move(other.teamStart);
+    }
+    return *this;
+}
+
+MappedScenario::~MappedScenario()
+{
+    unmap();
+}
+
+void MappedScenario::unmap()
+{
+    if (memory != nullptr)
+    {
+        munmap(memory, bytes);
+        memory = nullptr;
+    }
+}
+
+void MappedScenario::validate()
+{
+    const ScenarioHeader *header = static_cast<const ScenarioHeader *>(memory);
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        throw runtime_error("Not a scenario file");
+    }
+    if (header->version != VERSION || header->recordSize != sizeof(ScenarioRecord))
+    {
+        throw runtime_error("Unsupported scenario file version");
+    }
+    if (header->count != (bytes - sizeof(ScenarioHeader)) / sizeof(ScenarioRecord) ||
+        (bytes - sizeof(ScenarioHeader)) % sizeof(ScenarioRecord) != 0)
+    {
+        throw runtime_error("Truncated scenario file");
+    }
+    records = reinterpret_cast<const ScenarioRecord *>(static_cast<const char *>(memory) + sizeof(ScenarioHeader));
+    count = header->count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const ScenarioRecord &record = records[i];
+        int health = initialHealth(record.kind);
+        if (health == 0)
+        {
+            throw runtime_error("Invalid unit kind in scenario file");
+        }
+        if (record.health < 0 || record.health > health)
+        {
+            throw runtime_error("Invalid unit health in scenario file");
+        }
+        if (!isfinite(record.x) || !isfinite(record.y))
+        {
+            throw runtime_error("Invalid unit location in scenario file");
+        }
+        if (i > 0 && record.team < records[i - 1].team)
+        {
+            throw runtime_error("Scenario file units are not grouped by team");
+        }
+    }
+}
+
+void MappedScenario::indexTeams()
+{
+    unsigned int teams = count == 0 ? 0 : records[count - 1].team + 1U;
+    teamStart.assign(teams + 1, count);
+    for (size_t i = count; i-- > 0;)
+    {
+        teamStart[records[i].team] = i;
+    }
+    // Teams without units start where the next team does
+    for (unsigned int team = teams; team-- > 0;)
+    {
+        teamStart[team] = min(teamStart[team], teamStart[team + 1]);
+    }
+}
+
+size_t MappedScenario::size() const
+{
+    return count;
+}
+
+const ScenarioRecord *MappedScenario::begin() const
+{
+    return records;
+}
+
+const ScenarioRecord *MappedScenario::end() const
+{
+    return records + count;
+}
+
+unsigned int MappedScenario::teamCount() const
+{
+    return teamStart.empty() ? 0 : static_cast<unsigned int>(teamStart.size() - 1);
+}
+
+unsigned int MappedScenario::teamSize(unsigned int team) const
+{
+    if (team >= teamCount())
+    {
+        throw out_of_range("No such team in the scenario");
+    }
+    return static_cast<unsigned int>(teamStart[team + 1] - teamStart[team]);
+}
+
+unique_ptr<Team> MappedScenario::team(unsigned int team, Strategy strategy) const
+{
+    unsigned int size = teamSize(team);
+    if (size == 0)
+    {
+        throw invalid_argument("The team has no units in the scenario");
+    }
+    const ScenarioRecord *first = records + teamStart[team];
+    unique_ptr<Character> leader(createCharacter(*first));
+    unique_ptr<Team> result = makeTeam(strategy, leader.get(), size);
+    leader.release();
+    result->load(first + 1, size - 1);
+    return result;
+}
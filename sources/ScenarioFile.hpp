@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Strategy.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ariel
+{
+    // One unit of a scenario file, stored as raw bytes
+    struct ScenarioRecord
+    {
+        double x;
+        double y;
+        std::int32_t health;
+
+        // A CharacterKind (a cowboy or one of the ninjas)
+        std::uint8_t kind;
+
+        // Index of the team of the unit (the first unit of a team is its leader)
+        std::uint8_t team;
+
+        std::uint16_t reserved;
+    };
+
+    // Build the record of a character of the given team
+    ScenarioRecord makeRecord(const Character &character, std::uint8_t team);
+
+    // Number of bytes needed to build the character of a record (throws for kinds that can't
+    // be stored). The memory must also be aligned for a Character.
+    std::size_t characterSize(const ScenarioRecord &record);
+
+    // Build the character of a record in memory given by the caller, who owns both of them
+    Character *makeCharacter(const ScenarioRecord &record, void *memory);
+
+    // Write a scenario file. The records are grouped by team, keeping their order within a team.
+    void saveScenario(const std::string &path, std::vector<ScenarioRecord> records);
+
+    // Read-only memory mapping of a scenario file. The whole file is validated once when it is
+    // opened, after which its teams are built in one pass without checking unit by unit.
+    class MappedScenario
+    {
+    public:
+        // Map and validate a scenario file
+        explicit MappedScenario(const std::string &path);
+
+        MappedScenario(const MappedScenario &) = delete;
+        MappedScenario &operator=(const MappedScenario &) = delete;
+        MappedScenario(MappedScenario &&other) noexcept;
+        MappedScenario &operator=(MappedScenario &&other) noexcept;
+
+        // Unmap the file
+        ~MappedScenario();
+
+        // Records of the file
+        std::size_t size() const;
+        const ScenarioRecord *begin() const;
+        const ScenarioRecord *end() const;
+
+        // Number of teams (one more than the largest team index)
+        unsigned int teamCount() const;
+
+        // Number of units of a team
+        unsigned int teamSize(unsigned int team) const;
+
+        // Build a team of the given strategy from the units of a team, sized to fit them
+        std::unique_ptr<Team> team(unsigned int team, Strategy strategy) const;
+
+    private:
+        void *memory = nullptr;
+        std::size_t bytes = 0;
+        const ScenarioRecord *records = nullptr;
+        std::size_t count = 0;
+
+        // Index of the first record of every team, followed by the number of records
+        std::vector<std::size_t> teamStart;
+
+        void validate();
+        void indexTeams();
+        void unmap();
+    };
+}
@@ -0,0 +1,180 @@
+#include "ScenarioGenerator.hpp"
+#include <stdexcept>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    uint64_t rotateLeft(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+}
+
+uint64_t ariel::splitMix64(uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+Xoshiro256::Xoshiro256(uint64_t seed)
+{
+    // Consecutive splitmix64 outputs never give the all-zero state
+    for (uint64_t &word : state)
+    {
+        word = splitMix64(seed);
+        seed += 0x9E3779B97F4A7C15ULL;
+    }
+}
+
+uint64_t Xoshiro256::next()
+{
+    uint64_t result = rotateLeft(state[1] * 5, 7) * 9;
+    uint64_t shifted = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= shifted;
+    state[3] = rotateLeft(state[3], 45);
+    return result;
+}
+
+double Xoshiro256::uniform(double min, double max)
+{
+    // The top 53 bits give a double in [0, 1)
+    double unit = static_cast<double>(next() >> 11) * 0x1.0p-53;
+    return min + unit * (max - min);
+}
+
+uint64_t Xoshiro256::below(uint64_t bound)
+{
+    if (bound == 0)
+    {
+        throw invalid_argument("Bound must be positive");
+    }
+    // Reject the values above the largest multiple of bound to keep every result equally likely
+    uint64_t limit = -bound % bound;
+    uint64_t value = next();
+    while (value < limit)
+    {
+        value = next();
+    }
+    return value % bound;
+}
+
+ScenarioGenerator::ScenarioGenerator(uint64_t seed, double min, double max, KindMix mix) : generator(seed), min(min), max(max)
+{
+    if (!(min < max))
+    {
+        throw invalid_argument("The area of a scenario can't be empty");
+    }
+    validateMix(mix);
+    thresholds[0] = mix.cowboys;
+    thresholds[1] = thresholds[0] + mix.youngNinjas;
+    thresholds[2] = thresholds[1] + mix.trainedNinjas;
+    thresholds[3] = thresholds[2] + mix.oldNinjas;
+}
+
+void ScenarioGenerator::validateMix(const KindMix &mix)
+{
+    if (mix.cowboys < 0 || mix.youngNinjas < 0 || mix.trainedNinjas < 0 || mix.oldNinjas < 0)
+    {
+        throw invalid_argument("Kind weights can't be negative");
+    }
+    if (!(mix.cowboys + mix.youngNinjas + mix.trainedNinjas + mix.oldNinjas > 0))
+    {
+        throw invalid_argument("At least one kind needs a positive weight");
+    }
+}
+
+Point ScenarioGenerator::location()
+{
+    double x = generator.uniform(min, max);
+    double y = generator.uniform(min, max);
+    return Point(x, y);
+}
+
+CharacterKind ScenarioGenerator::kind()
+{
+    double pick = generator.uniform(0, thresholds[3]);
+    if (pick < thresholds[0])
+    {
+        return CharacterKind::Cowboy;
+    }
+    if (pick < thresholds[1])
+    {
+        return CharacterKind::YoungNinja;
+    }
+    if (pick < thresholds[2])
+    {
+        return CharacterKind::TrainedNinja;
+    }
+    return CharacterKind::OldNinja;
+}
+
+Character *ScenarioGenerator::character()
+{
+    return character(kind());
+}
+
+Character *ScenarioGenerator::character(CharacterKind kind)
+{
+    Point at = location();
+    switch (kind)
+    {
+    case CharacterKind::Cowboy:
+        return new Cowboy("Cowboy", at);
+    case CharacterKind::YoungNinja:
+        return new YoungNinja("YoungNinja", at);
+    case CharacterKind::TrainedNinja:
+        return new TrainedNinja("TrainedNinja", at);
+    case CharacterKind::OldNinja:
+        return new OldNinja("OldNinja", at);
+    default:
+        throw invalid_argument("Only cowboys and ninjas can be generated");
+    }
+}
+
+vector<Character *> ScenarioGenerator::characters(size_t count)
+{
+    vector<Character *> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        result.push_back(character());
+    }
+    return result;
+}
+
+void ScenarioGenerator::fill(Team &team, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        CharacterKind next = kind();
+        Point at = location();
+        switch (next)
+        {
+        case CharacterKind::Cowboy:
+            team.emplace<Cowboy>("Cowboy", at);
+            break;
+        case CharacterKind::YoungNinja:
+            team.emplace<YoungNinja>("YoungNinja", at);
+            break;
+        case CharacterKind::TrainedNinja:
+            team.emplace<TrainedNinja>("TrainedNinja", at);
+            break;
+        default:
+            team.emplace<OldNinja>("OldNinja", at);
+            break;
+        }
+    }
+}
+
+Xoshiro256 &ScenarioGenerator::random()
+{
+    return generator;
+}
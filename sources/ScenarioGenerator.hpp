@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Team.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ariel
+{
+    // Spread a number over a well mixed 64 bit value (used to derive seeds)
+    std::uint64_t splitMix64(std::uint64_t value);
+
+    // xoshiro256** generator: fast, and the same sequence on every platform for a given seed
+    class Xoshiro256
+    {
+    public:
+        explicit Xoshiro256(std::uint64_t seed = 1);
+
+        // Get the next 64 random bits
+        std::uint64_t next();
+
+        // Get a double in [min, max)
+        double uniform(double min, double max);
+
+        // Get an integer in [0, bound), bound must be positive
+        std::uint64_t below(std::uint64_t bound);
+
+    private:
+        std::array<std::uint64_t, 4> state;
+    };
+
+    // Relative weights of the kinds of the generated characters
+    struct KindMix
+    {
+        double cowboys = 1;
+        double youngNinjas = 1;
+        double trainedNinjas = 1;
+        double oldNinjas = 1;
+    };
+
+    // Bit-reproducible source of random characters and teams
+    class ScenarioGenerator
+    {
+    public:
+        // Constructor with the seed, the square the characters are placed in and the kind mix
+        explicit ScenarioGenerator(std::uint64_t seed, double min = -100, double max = 100, KindMix mix = KindMix());
+
+        // Get a random location in the square
+        Point location();
+
+        // Get a random kind following the mix
+        CharacterKind kind();
+
+        // Create a random character (owned by the caller)
+        Character *character();
+
+        // Create a character of the given kind at a random location (owned by the caller)
+        Character *character(CharacterKind kind);
+
+        // Create count random characters (owned by the caller)
+        std::vector<Character *> characters(std::size_t count);
+
+        // Add count random characters to a team, built in the memory of the team
+        void fill(Team &team, unsigned int count);
+
+        // Get the underlying generator
+        Xoshiro256 &random();
+
+    private:
+        Xoshiro256 generator;
+        double min;
+        double max;
+
+        // Running totals of the mix weights, in the order of KindMix
+        std::array<double, 4> thresholds;
+
+        static void validateMix(const KindMix &mix);
+    };
+}
@@ -0,0 +1,568 @@
+#include "SoABattle.hpp"
+#include "UnitTraits.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <typeinfo>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    // parallelAttack() plans the units in stretches that start this long and double while the target survives
+    const unsigned int FIRST_STRETCH = 256;
+
+    // Units planned by one task of the pool
+    const unsigned int PLAN_BLOCK = 1024;
+}
+
+unsigned int SoATeam::size() const
+{
+    return static_cast<unsigned int>(source.size());
+}
+
+SoABattle::SoABattle(Team *first, Team *second)
+{
+    if (first == nullptr || second == nullptr)
+    {
+        throw invalid_argument("Can't copy a NULL team");
+    }
+    if (first == second)
+    {
+        throw invalid_argument("A team can't fight itself");
+    }
+    ingest(first, sides[0]);
+    ingest(second, sides[1]);
+}
+
+void SoABattle::ingest(Team *team, SoATeam &side)
+{
+    if (typeid(*team) == typeid(Team))
+    {
+        side.attackOrder = AttackOrder::CowboysFirst;
+    }
+    else if (typeid(*team) == typeid(Team2))
+    {
+        side.attackOrder = AttackOrder::Insertion;
+    }
+    else
+    {
+        throw invalid_argument("Only Team and Team2 can be copied to the structure-of-arrays engine");
+    }
+
+    side.team = team;
+    side.distanceMode = team->distanceMode();
+    for (Character *character : team->characters)
+    {
+        if (character == nullptr)
+        {
+            continue;
+        }
+        Cowboy *cowboy = character->isCowboy() ? static_cast<Cowboy *>(character) : nullptr;
+        Ninja *ninja = character->isNinja() ? static_cast<Ninja *>(character) : nullptr;
+        if (cowboy == nullptr && ninja == nullptr)
+        {
+            throw invalid_argument("Invalid character type (not Cowboy or Ninja)");
+        }
+        if (character == team->leader)
+        {
+            side.leader = side.size();
+        }
+        Point location = character->getLocation();
+        side.x.push_back(location.whatX());
+        side.y.push_back(location.whatY());
+        side.health.push_back(character->whatHealth());
+        side.bullets.push_back(cowboy != nullptr ? cowboy->bullets : 0);
+        side.speed.push_back(ninja != nullptr ? ninja->speed : 0);
+        side.kind.push_back(cowboy != nullptr ? UnitKind::Cowboy : UnitKind::Ninja);
+        side.source.push_back(character);
+        if (character->isAlive())
+        {
+            side.index.insert(character, side.size() - 1, location);
+            side.alive++;
+        }
+    }
+
+    if (side.attackOrder == AttackOrder::Insertion)
+    {
+        for (unsigned int unit = 0; unit < side.size(); unit++)
+        {
+            side.order.push_back(unit);
+        }
+        side.phaseSplit = side.size();
+        return;
+    }
+    // Cowboys in slot order, then the ninjas from the back of the team
+    for (unsigned int unit = 0; unit < side.size(); unit++)
+    {
+        if (side.kind[unit] == UnitKind::Cowboy)
+        {
+            side.order.push_back(unit);
+        }
+    }
+    side.phaseSplit = static_cast<unsigned int>(side.order.size());
+    for (unsigned int unit = side.size(); unit-- > 0;)
+    {
+        if (side.kind[unit] == UnitKind::Ninja)
+        {
+            side.order.push_back(unit);
+        }
+    }
+}
+
+int SoABattle::stillAlive(unsigned int side) const
+{
+    return static_cast<int>(team(side).alive);
+}
+
+const SoATeam &SoABattle::team(unsigned int side) const
+{
+    if (side > 1)
+    {
+        throw out_of_range("A battle has only two sides");
+    }
+    return sides[side];
+}
+
+unsigned int SoABattle::nearest(const SoATeam &side, double originX, double originY, DistanceMode mode)
+{
+    // Same distance and first-checked tie breaking as Team::CloseCharacter
+    return side.index.nearestSlot(Point(originX, originY), mode);
+}
+
+void SoABattle::damage(SoATeam &side, unsigned int unit, int amount)
+{
+    int &health = side.health[unit];
+    if (health > 0 && amount > 0)
+    {
+        health -= amount;
+        if (health <= 0)
+        {
+            health = 0;
+            side.alive--;
+            side.index.remove(side.source[unit], Point(side.x[unit], side.y[unit]));
+        }
+    }
+}
+
+void SoABattle::moveUnit(SoATeam &side, unsigned int unit, const Point &to)
+{
+    side.index.move(side.source[unit], Point(side.x[unit], side.y[unit]), to);
+    side.x[unit] = to.whatX();
+    side.y[unit] = to.whatY();
+}
+
+unsigned int SoABattle::retarget(const SoATeam &attackers, const SoATeam &defenders, unsigned int target)
+{
+    if (defenders.health[target] > 0)
+    {
+        return target;
+    }
+    return nearest(defenders, attackers.x[attackers.leader], attackers.y[attackers.leader], attackers.distanceMode);
+}
+
+void SoABattle::validateAttack(unsigned int attacker) const
+{
+    const SoATeam &attackers = team(attacker);
+    const SoATeam &defenders = sides[1 - attacker];
+    if (attackers.alive == 0)
+    {
+        throw runtime_error("Dead/empty team can't attack");
+    }
+    if (defenders.alive == 0)
+    {
+        if (attackers.attackOrder == AttackOrder::Insertion)
+        {
+            throw invalid_argument("Can't attack dead/empty team");
+        }
+        throw runtime_error("Can't attack dead/empty team");
+    }
+}
+
+void SoABattle::ensureLeaderIsAlive(SoATeam &attackers)
+{
+    if (attackers.health[attackers.leader] <= 0)
+    {
+        attackers.leader = nearest(attackers, attackers.x[attackers.leader], attackers.y[attackers.leader], attackers.distanceMode);
+        attackers.appointed.push_back(attackers.leader);
+    }
+}
+
+void SoABattle::attack(unsigned int attacker)
+{
+    validateAttack(attacker);
+    SoATeam &attackers = sides[attacker];
+    SoATeam &defenders = sides[1 - attacker];
+
+    ensureLeaderIsAlive(attackers);
+    unsigned int target = nearest(defenders, attackers.x[attackers.leader], attackers.y[attackers.leader], attackers.distanceMode);
+    if (target == NONE)
+    {
+        return;
+    }
+
+    performPhase(attackers, defenders, 0, attackers.phaseSplit, target, false);
+    if (attackers.attackOrder == AttackOrder::CowboysFirst)
+    {
+        // Like Team::attack, the ninjas start from the target chosen before the cowboy phase
+        performPhase(attackers, defenders, attackers.phaseSplit, attackers.size(), target, true);
+    }
+}
+
+unsigned int SoABattle::performPhase(SoATeam &attackers, SoATeam &defenders, unsigned int begin, unsigned int end, unsigned int target, bool retargetAfterDead)
+{
+    for (unsigned int position = begin; position < end; position++)
+    {
+        unsigned int unit = attackers.order[position];
+        bool alive = attackers.health[unit] > 0;
+        if (alive)
+        {
+            performAction(attackers, defenders, unit, target);
+        }
+        if (alive || retargetAfterDead)
+        {
+            target = retarget(attackers, defenders, target);
+            if (target == NONE)
+            {
+                break;
+            }
+        }
+    }
+    return target;
+}
+
+void SoABattle::performAction(SoATeam &attackers, SoATeam &defenders, unsigned int unit, unsigned int target)
+{
+    if (attackers.kind[unit] == UnitKind::Cowboy)
+    {
+        if (attackers.bullets[unit] > 0)
+        {
+            attackers.bullets[unit]--;
+            damage(defenders, target, COWBOY_TRAITS.damage);
+        }
+        else
+        {
+            attackers.bullets[unit] = COWBOY_TRAITS.bullets;
+        }
+        return;
+    }
+
+    Point position(attackers.x[unit], attackers.y[unit]);
+    Point targetPosition(defenders.x[target], defenders.y[target]);
+    if (position.withinUnitDistance(targetPosition))
+    {
+        if (defenders.health[target] > 0)
+        {
+            damage(defenders, target, NINJA_TRAITS.damage);
+        }
+    }
+    else if (!position.compare(targetPosition))
+    {
+        moveUnit(attackers, unit, Point::moveTowards(position, targetPosition, attackers.speed[unit]));
+    }
+}
+
+void SoABattle::parallelAttack(unsigned int attacker, WorkStealingPool &pool)
+{
+    validateAttack(attacker);
+    SoATeam &attackers = sides[attacker];
+    SoATeam &defenders = sides[1 - attacker];
+
+    ensureLeaderIsAlive(attackers);
+    unsigned int target = nearest(defenders, attackers.x[attackers.leader], attackers.y[attackers.leader], attackers.distanceMode);
+    if (target == NONE)
+    {
+        return;
+    }
+
+    parallelPhase(attackers, defenders, 0, attackers.phaseSplit, target, false, pool);
+    if (attackers.attackOrder == AttackOrder::CowboysFirst)
+    {
+        parallelPhase(attackers, defenders, attackers.phaseSplit, attackers.size(), target, true, pool);
+    }
+}
+
+unsigned int SoABattle::parallelPhase(SoATeam &attackers, SoATeam &defenders, unsigned int begin, unsigned int end, unsigned int target, bool retargetAfterDead, WorkStealingPool &pool)
+{
+    unsigned int position = begin;
+    // The ninja phase starts on the first target, which the cowboys may have killed: step as performPhase does until it is replaced
+    while (position < end && defenders.health[target] <= 0)
+    {
+        unsigned int unit = attackers.order[position++];
+        bool alive = attackers.health[unit] > 0;
+        if (alive)
+        {
+            performAction(attackers, defenders, unit, target);
+        }
+        if (alive || retargetAfterDead)
+        {
+            target = retarget(attackers, defenders, target);
+            if (target == NONE)
+            {
+                return NONE;
+            }
+        }
+    }
+
+    unsigned int stretch = FIRST_STRETCH;
+    while (position < end)
+    {
+        unsigned int stop = min(end, position + stretch);
+        planStretch(attackers, defenders, position, stop, target, pool);
+
+        // First unit whose damage adds up to the health of the target
+        auto killer = lower_bound(stretchDamage.begin(), stretchDamage.end(), defenders.health[target]);
+        bool killed = killer != stretchDamage.end();
+        unsigned int last = killed ? position + static_cast<unsigned int>(killer - stretchDamage.begin()) : stop - 1;
+        applyStretch(attackers, defenders, position, last, target);
+        position = last + 1;
+
+        if (killed)
+        {
+            target = retarget(attackers, defenders, target);
+            if (target == NONE)
+            {
+                return NONE;
+            }
+            stretch = FIRST_STRETCH;
+        }
+        else
+        {
+            stretch *= 2;
+        }
+    }
+    return target;
+}
+
+void SoABattle::planStretch(const SoATeam &attackers, const SoATeam &defenders, unsigned int begin, unsigned int end, unsigned int target, WorkStealingPool &pool)
+{
+    unsigned int count = end - begin;
+    stretchDamage.resize(count);
+    stretchX.resize(count);
+    stretchY.resize(count);
+    if (count < 2 * PLAN_BLOCK)
+    {
+        for (unsigned int offset = 0; offset < count; offset++)
+        {
+            stretchDamage[offset] = planUnit(attackers, defenders, begin + offset, offset, target);
+        }
+    }
+    else
+    {
+        // Every task only writes the plans of its own block
+        pool.run((count + PLAN_BLOCK - 1) / PLAN_BLOCK, [&, begin, count, target](size_t block)
+                 {
+                     unsigned int first = static_cast<unsigned int>(block) * PLAN_BLOCK;
+                     unsigned int stop = min(count, first + PLAN_BLOCK);
+                     for (unsigned int offset = first; offset < stop; offset++)
+                     {
+                         stretchDamage[offset] = planUnit(attackers, defenders, begin + offset, offset, target);
+                     } });
+    }
+    partial_sum(stretchDamage.begin(), stretchDamage.end(), stretchDamage.begin());
+}
+
+int SoABattle::planUnit(const SoATeam &attackers, const SoATeam &defenders, unsigned int position, unsigned int offset, unsigned int target)
+{
+    // Same actions as performAction on a living target, without touching the state
+    unsigned int unit = attackers.order[position];
+    stretchX[offset] = attackers.x[unit];
+    stretchY[offset] = attackers.y[unit];
+    if (attackers.health[unit] <= 0)
+    {
+        return 0;
+    }
+    if (attackers.kind[unit] == UnitKind::Cowboy)
+    {
+        return attackers.bullets[unit] > 0 ? COWBOY_TRAITS.damage : 0;
+    }
+    Point location(attackers.x[unit], attackers.y[unit]);
+    Point targetLocation(defenders.x[target], defenders.y[target]);
+    if (location.withinUnitDistance(targetLocation))
+    {
+        return NINJA_TRAITS.damage;
+    }
+    if (!location.compare(targetLocation))
+    {
+        Point next = Point::moveTowards(location, targetLocation, attackers.speed[unit]);
+        stretchX[offset] = next.whatX();
+        stretchY[offset] = next.whatY();
+    }
+    return 0;
+}
+
+void SoABattle::applyStretch(SoATeam &attackers, SoATeam &defenders, unsigned int begin, unsigned int last, unsigned int target)
+{
+    for (unsigned int position = begin; position <= last; position++)
+    {
+        unsigned int unit = attackers.order[position];
+        if (attackers.health[unit] <= 0)
+        {
+            continue;
+        }
+        unsigned int offset = position - begin;
+        if (attackers.kind[unit] == UnitKind::Cowboy)
+        {
+            attackers.bullets[unit] = attackers.bullets[unit] > 0 ? attackers.bullets[unit] - 1 : COWBOY_TRAITS.bullets;
+        }
+        else if (stretchX[offset] != attackers.x[unit] || stretchY[offset] != attackers.y[unit])
+        {
+            moveUnit(attackers, unit, Point(stretchX[offset], stretchY[offset]));
+        }
+    }
+    // The hits of the stretch in one go, the target dies at the last one at the latest
+    damage(defenders, target, stretchDamage[last - begin]);
+}
+
+void SoABattle::simultaneousRound(WorkStealingPool *pool)
+{
+    if (sides[0].alive == 0 || sides[1].alive == 0)
+    {
+        throw runtime_error("Dead/empty team can't attack");
+    }
+    prepareBuffers(sides[0]);
+    prepareBuffers(sides[1]);
+
+    // The units only read the state of the round start and write their own entries of the second buffer
+    unsigned int firstSize = sides[0].size();
+    auto plan = [this, firstSize](size_t unit)
+    {
+        if (unit < firstSize)
+        {
+            planAction(sides[0], sides[1], static_cast<unsigned int>(unit));
+        }
+        else
+        {
+            planAction(sides[1], sides[0], static_cast<unsigned int>(unit - firstSize));
+        }
+    };
+    size_t units = size_t{firstSize} + sides[1].size();
+    if (pool != nullptr)
+    {
+        pool->run(units, plan);
+    }
+    else
+    {
+        for (size_t unit = 0; unit < units; unit++)
+        {
+            plan(unit);
+        }
+    }
+
+    applyPlans(sides[0], sides[1]);
+    applyPlans(sides[1], sides[0]);
+    for (SoATeam &side : sides)
+    {
+        if (side.alive > 0)
+        {
+            ensureLeaderIsAlive(side);
+        }
+    }
+}
+
+void SoABattle::prepareBuffers(SoATeam &side)
+{
+    side.nextX = side.x;
+    side.nextY = side.y;
+    side.nextBullets = side.bullets;
+    side.hitTarget.assign(side.size(), unsigned{NONE});
+    side.hitDamage.assign(side.size(), 0);
+}
+
+void SoABattle::planAction(SoATeam &attackers, const SoATeam &defenders, unsigned int unit)
+{
+    if (attackers.health[unit] <= 0)
+    {
+        return;
+    }
+    unsigned int target = nearest(defenders, attackers.x[unit], attackers.y[unit], attackers.distanceMode);
+    if (target == NONE)
+    {
+        return;
+    }
+
+    // Same actions as performAction, written to the second buffer
+    if (attackers.kind[unit] == UnitKind::Cowboy)
+    {
+        if (attackers.bullets[unit] > 0)
+        {
+            attackers.nextBullets[unit] = attackers.bullets[unit] - 1;
+            attackers.hitTarget[unit] = target;
+            attackers.hitDamage[unit] = COWBOY_TRAITS.damage;
+        }
+        else
+        {
+            attackers.nextBullets[unit] = COWBOY_TRAITS.bullets;
+        }
+        return;
+    }
+
+    Point position(attackers.x[unit], attackers.y[unit]);
+    Point targetPosition(defenders.x[target], defenders.y[target]);
+    if (position.withinUnitDistance(targetPosition))
+    {
+        attackers.hitTarget[unit] = target;
+        attackers.hitDamage[unit] = NINJA_TRAITS.damage;
+    }
+    else if (!position.compare(targetPosition))
+    {
+        Point next = Point::moveTowards(position, targetPosition, attackers.speed[unit]);
+        attackers.nextX[unit] = next.whatX();
+        attackers.nextY[unit] = next.whatY();
+    }
+}
+
+void SoABattle::applyPlans(SoATeam &attackers, SoATeam &defenders)
+{
+    for (unsigned int unit = 0; unit < attackers.size(); unit++)
+    {
+        attackers.bullets[unit] = attackers.nextBullets[unit];
+        if (attackers.nextX[unit] != attackers.x[unit] || attackers.nextY[unit] != attackers.y[unit])
+        {
+            moveUnit(attackers, unit, Point(attackers.nextX[unit], attackers.nextY[unit]));
+        }
+        // Damage adds up, so the order of the hits doesn't change the outcome
+        if (attackers.hitTarget[unit] != NONE)
+        {
+            damage(defenders, attackers.hitTarget[unit], attackers.hitDamage[unit]);
+        }
+    }
+}
+
+void SoABattle::writeBack()
+{
+    for (SoATeam &side : sides)
+    {
+        for (unsigned int unit = 0; unit < side.size(); unit++)
+        {
+            Character *character = side.source[unit];
+            int health = character->whatHealth();
+            if (side.health[unit] < health)
+            {
+                character->hit(health - side.health[unit]);
+            }
+            Point location = character->getLocation();
+            if (location.whatX() != side.x[unit] || location.whatY() != side.y[unit])
+            {
+                character->addLocation(Point(side.x[unit], side.y[unit]));
+            }
+            if (side.kind[unit] == UnitKind::Cowboy)
+            {
+                static_cast<Cowboy *>(character)->bullets = side.bullets[unit];
+            }
+        }
+
+        // Every appointed leader keeps its flag, as with Team::newLeader
+        for (unsigned int unit : side.appointed)
+        {
+            if (!side.source[unit]->isLeader())
+            {
+                side.source[unit]->setLeader();
+            }
+        }
+        side.appointed.clear();
+        side.team->leader = side.source[side.leader];
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "Team.hpp"
+#include "SpatialGrid.hpp"
+#include "WorkStealingPool.hpp"
+#include <array>
+#include <vector>
+
+namespace ariel
+{
+    // Kind of a unit in the structure-of-arrays engine
+    enum class UnitKind : unsigned char
+    {
+        Cowboy,
+        Ninja
+    };
+
+    // Order in which the members of a team act during an attack
+    enum class AttackOrder : unsigned char
+    {
+        CowboysFirst, // Team: cowboys, then ninjas from the back
+        Insertion     // Team2: insertion order
+    };
+
+    // Contiguous copy of the state of one team. Units are stored in slot order,
+    // so scans over them break ties exactly like Team::CloseCharacter.
+    struct SoATeam
+    {
+        std::vector<double> x, y;
+        std::vector<int> health, bullets, speed;
+        std::vector<UnitKind> kind;
+
+        // Member each unit was copied from
+        std::vector<Character *> source;
+
+        // Units in the order they act, the first phaseSplit of them act in the cowboy phase
+        std::vector<unsigned int> order;
+        unsigned int phaseSplit = 0;
+
+        AttackOrder attackOrder = AttackOrder::CowboysFirst;
+
+        // How the team compares distances when it picks targets (copied from the team)
+        DistanceMode distanceMode = DistanceMode::Truncated;
+        unsigned int leader = 0;
+        unsigned int alive = 0;
+
+        // Units that were appointed leader since the copy was taken
+        std::vector<unsigned int> appointed;
+
+        // Living units by location, the grid slot of a unit is its index
+        SpatialGrid index;
+
+        // Second buffer of the simultaneous rounds, every unit only writes its own entries:
+        // its next location and ammunition, and the enemy it hits with the damage (NONE for no hit)
+        std::vector<double> nextX, nextY;
+        std::vector<int> nextBullets;
+        std::vector<unsigned int> hitTarget;
+        std::vector<int> hitDamage;
+
+        Team *team = nullptr;
+
+        unsigned int size() const;
+    };
+
+    // Battle engine running the attack rules of Team and Team2 on a structure-of-arrays copy
+    // of two teams. The teams must not be touched until writeBack() is called.
+    class SoABattle
+    {
+    public:
+        // Index returned when there is no unit to pick
+        static const unsigned int NONE = SpatialGrid::NO_SLOT;
+
+        // Constructor copying the members of both teams (Team or Team2 only)
+        SoABattle(Team *first, Team *second);
+
+        // Perform Team::attack (or Team2::attack) of the given side (0 or 1) on the other side
+        void attack(unsigned int attacker);
+
+        // Same attack with the same outcome, spreading the work over the pool. While the target stays the same
+        // the units don't depend on each other: they are planned in parallel, and a prefix sum of their damage
+        // tells exactly which unit kills the target, after which the next target is picked as attack() does.
+        void parallelAttack(unsigned int attacker, WorkStealingPool &pool);
+
+        // Get the number of living units of a side
+        int stillAlive(unsigned int side) const;
+
+        // Get the state of a side
+        const SoATeam &team(unsigned int side) const;
+
+        // Play a round where the units of both sides act at once. Every living unit reads the state of the
+        // round start and acts on the living enemy closest to itself; the damage, moves and reloads are
+        // applied together at the end of the round, and dead leaders are replaced. The units are spread
+        // over the threads of the pool (without a pool they run on the calling thread, with the same result).
+        void simultaneousRound(WorkStealingPool *pool = nullptr);
+
+        // Copy health, positions, ammunition and leaders back to the original teams
+        void writeBack();
+
+    private:
+        std::array<SoATeam, 2> sides;
+
+        // Plans of the units of the stretch being looked at by parallelAttack(): the damage done so far
+        // in the stretch (a prefix sum) and the location every unit moves to
+        std::vector<int> stretchDamage;
+        std::vector<double> stretchX, stretchY;
+
+        static void ingest(Team *team, SoATeam &side);
+        static unsigned int nearest(const SoATeam &side, double originX, double originY, DistanceMode mode);
+        static void damage(SoATeam &side, unsigned int unit, int amount);
+        static void moveUnit(SoATeam &side, unsigned int unit, const Point &to);
+        static unsigned int retarget(const SoATeam &attackers, const SoATeam &defenders, unsigned int target);
+
+        void validateAttack(unsigned int attacker) const;
+        void ensureLeaderIsAlive(SoATeam &attackers);
+        unsigned int performPhase(SoATeam &attackers, SoATeam &defenders, unsigned int begin, unsigned int end, unsigned int target, bool retargetAfterDead);
+        void performAction(SoATeam &attackers, SoATeam &defenders, unsigned int unit, unsigned int target);
+        unsigned int parallelPhase(SoATeam &attackers, SoATeam &defenders, unsigned int begin, unsigned int end, unsigned int target, bool retargetAfterDead, WorkStealingPool &pool);
+        void planStretch(const SoATeam &attackers, const SoATeam &defenders, unsigned int begin, unsigned int end, unsigned int target, WorkStealingPool &pool);
+        int planUnit(const SoATeam &attackers, const SoATeam &defenders, unsigned int position, unsigned int offset, unsigned int target);
+        void applyStretch(SoATeam &attackers, SoATeam &defenders, unsigned int begin, unsigned int last, unsigned int target);
+
+        static void prepareBuffers(SoATeam &side);
+        static void planAction(SoATeam &attackers, const SoATeam &defenders, unsigned int unit);
+        static void applyPlans(SoATeam &attackers, SoATeam &defenders);
+    };
+}
@@ -0,0 +1,350 @@
+#include "SpatialGrid.hpp"
+#include "Character.hpp"
+#include "NearestKernel.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    // Cell coordinates are clamped so that far away characters still map to a valid key
+    const double MAX_CELL_COORDINATE = 2147483647.0;
+
+    // Gaps to cells are shrunk by this fraction of the coordinates involved, so that the
+    // rounding of cell borders can never prune a cell holding a closer character
+    const double GAP_SLACK = 1e-9;
+}
+
+SpatialGrid::SpatialGrid(double cellSize) : cellSize(cellSize)
+{
+    if (!(cellSize > 0))
+    {
+        throw invalid_argument("Cell size must be positive");
+    }
+}
+
+bool SpatialGrid::outOfRange(const Point &point) const
+{
+    // Also true for NaN coordinates
+    return !(fabs(point.whatX() / cellSize) < MAX_CELL_COORDINATE && fabs(point.whatY() / cellSize) < MAX_CELL_COORDINATE);
+}
+
+int64_t SpatialGrid::cellCoordinate(double value) const
+{
+    double cell = floor(value / cellSize);
+    if (std::isnan(cell))
+    {
+        return 0;
+    }
+    cell = std::clamp(cell, -MAX_CELL_COORDINATE, MAX_CELL_COORDINATE);
+    return static_cast<int64_t>(cell);
+}
+
+SpatialGrid::CellKey SpatialGrid::makeKey(int64_t cellX, int64_t cellY)
+{
+    return (static_cast<CellKey>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellY);
+}
+
+SpatialGrid::CellKey SpatialGrid::keyOf(const Point &point) const
+{
+    return makeKey(cellCoordinate(point.whatX()), cellCoordinate(point.whatY()));
+}
+
+void SpatialGrid::insert(Character *character, unsigned int slot)
+{
+    insert(character, slot, character->getLocation());
+}
+
+void SpatialGrid::insert(Character *character, unsigned int slot, const Point &location)
+{
+    Cell &cell = cells[keyOf(location)];
+    // Keep every cell sorted by slot, scans then meet the candidates in slot order
+    auto position = std::upper_bound(cell.slots.begin(), cell.slots.end(), slot) - cell.slots.begin();
+    cell.characters.insert(cell.characters.begin() + position, character);
+    cell.slots.insert(cell.slots.begin() + position, slot);
+    cell.xs.insert(cell.xs.begin() + position, location.whatX());
+    cell.ys.insert(cell.ys.begin() + position, location.whatY());
+    entries++;
+    if (outOfRange(location))
+    {
+        farEntries++;
+    }
+}
+
+size_t SpatialGrid::Cell::find(const Character *character) const
+{
+    return static_cast<size_t>(std::find(characters.begin(), characters.end(), character) - characters.begin());
+}
+
+void SpatialGrid::Cell::erase(size_t index)
+{
+    auto offset = static_cast<ptrdiff_t>(index);
+    characters.erase(characters.begin() + offset);
+    slots.erase(slots.begin() + offset);
+    xs.erase(xs.begin() + offset);
+    ys.erase(ys.begin() + offset);
+}
+
+void SpatialGrid::remove(Character *character, const Point &location)
+{
+    auto found = cells.find(keyOf(location));
+    if (found == cells.end())
+    {
+        return;
+    }
+    Cell &cell = found->second;
+    size_t index = cell.find(character);
+    if (index < cell.characters.size())
+    {
+        cell.erase(index);
+        entries--;
+        if (outOfRange(location))
+        {
+            farEntries--;
+        }
+    }
+    if (cell.characters.empty())
+    {
+        cells.erase(found);
+    }
+}
+
+void SpatialGrid::move(Character *character, const Point &from, const Point &to)
+{
+    auto found = cells.find(keyOf(from));
+    if (found == cells.end())
+    {
+        return;
+    }
+    Cell &cell = found->second;
+    size_t index = cell.find(character);
+    if (index == cell.characters.size())
+    {
+        return;
+    }
+    if (keyOf(from) == keyOf(to) && outOfRange(from) == outOfRange(to))
+    {
+        cell.xs[index] = to.whatX();
+        cell.ys[index] = to.whatY();
+        return;
+    }
+    unsigned int slot = cell.slots[index];
+    remove(character, from);
+    insert(character, slot, to);
+}
+
+unsigned int SpatialGrid::size() const
+{
+    return entries;
+}
+
+void SpatialGrid::clear()
+{
+    cells.clear();
+    entries = 0;
+    farEntries = 0;
+}
+
+void SpatialGrid::scanCell(const Cell &cell, const Point &origin, DistanceMode mode, const SlotRange &skip, Candidate &best)
+{
+    if (skip.begin >= skip.end)
+    {
+        scanRange(cell, 0, cell.slots.size(), origin, mode, best);
+        return;
+    }
+    // The members of a cell are sorted by slot, so the skipped ones sit together
+    size_t low = static_cast<size_t>(std::lower_bound(cell.slots.begin(), cell.slots.end(), skip.begin) - cell.slots.begin());
+    size_t high = static_cast<size_t>(std::lower_bound(cell.slots.begin() + static_cast<ptrdiff_t>(low), cell.slots.end(), skip.end) - cell.slots.begin());
+    scanRange(cell, 0, low, origin, mode, best);
+    scanRange(cell, high, cell.slots.size(), origin, mode, best);
+}
+
+void SpatialGrid::scanRange(const Cell &cell, size_t begin, size_t end, const Point &origin, DistanceMode mode, Candidate &best)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    const double *xs = cell.xs.data() + begin;
+    const double *ys = cell.ys.data() + begin;
+    size_t count = end - begin;
+    if (mode == DistanceMode::Squared)
+    {
+        size_t index = nearestSquaredIndex(xs, ys, count, origin.whatX(), origin.whatY());
+        if (index == count)
+        {
+            return;
+        }
+        index += begin;
+        double dx = origin.whatX() - cell.xs[index];
+        double dy = origin.whatY() - cell.ys[index];
+        double squared = dx * dx + dy * dy;
+        unsigned int slot = cell.slots[index];
+        if (best.character == nullptr || squared < best.squared || (squared == best.squared && slot < best.slot))
+        {
+            best.character = cell.characters[index];
+            best.squared = squared;
+            best.slot = slot;
+        }
+        return;
+    }
+
+    // First member of the cell with the smallest truncated distance, i.e. the lowest such slot
+    size_t index = nearestIndex(xs, ys, count, origin.whatX(), origin.whatY());
+    if (index == count)
+    {
+        return;
+    }
+    index += begin;
+    // Same distance, truncation and tie breaking as Character::distance in a scan over the team slots
+    double dx = origin.whatX() - cell.xs[index];
+    double dy = origin.whatY() - cell.ys[index];
+    int distance = static_cast<int>(sqrt(dx * dx + dy * dy));
+    unsigned int slot = cell.slots[index];
+    if (distance < best.distance || (best.character != nullptr && distance == best.distance && slot < best.slot))
+    {
+        best.character = cell.characters[index];
+        best.distance = distance;
+        best.slot = slot;
+    }
+}
+
+bool SpatialGrid::outOfReach(double gapSquared, const Candidate &best, DistanceMode mode)
+{
+    if (best.character == nullptr)
+    {
+        return false;
+    }
+    if (mode == DistanceMode::Squared)
+    {
+        // Equal squares could still win on the slot
+        return gapSquared > best.squared;
+    }
+    // Beyond the truncated distance of the best candidate ((d + 1)^2 is exact for int distances)
+    double bound = best.distance + 1.0;
+    return gapSquared >= bound * bound;
+}
+
+void SpatialGrid::probeCell(int64_t cellX, int64_t cellY, const Point &origin, DistanceMode mode, const SlotRange &skip, Candidate &best) const
+{
+    if (best.character != nullptr)
+    {
+        // Skip cells that lie entirely out of reach of the best candidate
+        double low = static_cast<double>(cellX) * cellSize;
+        double high = static_cast<double>(cellX + 1) * cellSize;
+        double slack = GAP_SLACK * (fabs(origin.whatX()) + fabs(low) + cellSize);
+        double gapX = std::max({low - origin.whatX(), origin.whatX() - high, 0.0});
+        gapX = std::max(gapX - slack, 0.0);
+        low = static_cast<double>(cellY) * cellSize;
+        high = static_cast<double>(cellY + 1) * cellSize;
+        slack = GAP_SLACK * (fabs(origin.whatY()) + fabs(low) + cellSize);
+        double gapY = std::max({low - origin.whatY(), origin.whatY() - high, 0.0});
+        gapY = std::max(gapY - slack, 0.0);
+        if (outOfReach(gapX * gapX + gapY * gapY, best, mode))
+        {
+            return;
+        }
+    }
+    auto found = cells.find(makeKey(cellX, cellY));
+    if (found != cells.end())
+    {
+        scanCell(found->second, origin, mode, skip, best);
+    }
+}
+
+SpatialGrid::Candidate SpatialGrid::scanAll(const Point &origin, DistanceMode mode, const SlotRange &skip) const
+{
+    Candidate best;
+    best.distance = INT_MAX;
+    for (const auto &cell : cells)
+    {
+        scanCell(cell.second, origin, mode, skip, best);
+    }
+    return best;
+}
+
+Character *SpatialGrid::nearest(const Character *origin, DistanceMode mode) const
+{
+    if (entries == 0)
+    {
+        return nullptr;
+    }
+    if (origin == nullptr)
+    {
+        throw invalid_argument("NULL character");
+    }
+    return search(origin->getLocation(), mode, SlotRange{}).character;
+}
+
+unsigned int SpatialGrid::nearestSlot(const Point &origin, DistanceMode mode) const
+{
+    if (entries == 0)
+    {
+        return NO_SLOT;
+    }
+    return search(origin, mode, SlotRange{}).slot;
+}
+
+unsigned int SpatialGrid::nearestSlotOutside(const Point &origin, unsigned int skipBegin, unsigned int skipEnd, DistanceMode mode) const
+{
+    if (entries == 0)
+    {
+        return NO_SLOT;
+    }
+    Candidate best = search(origin, mode, SlotRange{skipBegin, skipEnd});
+    return best.character == nullptr ? NO_SLOT : best.slot;
+}
+
+SpatialGrid::Candidate SpatialGrid::search(const Point &location, DistanceMode mode, const SlotRange &skip) const
+{
+    // Clamped cells break the ring distance bound
+    if (farEntries > 0 || outOfRange(location))
+    {
+        return scanAll(location, mode, skip);
+    }
+    int64_t centerX = cellCoordinate(location.whatX());
+    int64_t centerY = cellCoordinate(location.whatY());
+
+    Candidate best;
+    best.distance = INT_MAX;
+    size_t probed = 0;
+
+    // Search rings of cells around the origin until no unvisited cell can hold a closer (or tied) character
+    for (int64_t ring = 0;; ring++)
+    {
+        // Every cell of this ring and beyond is at least (ring - 1) cells away
+        double reach = static_cast<double>(ring) * cellSize;
+        double gap = std::max(reach - cellSize - GAP_SLACK * (fabs(location.whatX()) + fabs(location.whatY()) + reach), 0.0);
+        if (ring > 0 && outOfReach(gap * gap, best, mode))
+        {
+            return best;
+        }
+        // Sparse grids are cheaper to scan cell by cell than ring by ring
+        if (probed > cells.size())
+        {
+            return scanAll(location, mode, skip);
+        }
+
+        if (ring == 0)
+        {
+            probeCell(centerX, centerY, location, mode, skip, best);
+            probed++;
+            continue;
+        }
+        for (int64_t offset = -ring; offset <= ring; offset++)
+        {
+            probeCell(centerX + offset, centerY - ring, location, mode, skip, best);
+            probeCell(centerX + offset, centerY + ring, location, mode, skip, best);
+        }
+        for (int64_t offset = -ring + 1; offset < ring; offset++)
+        {
+            probeCell(centerX - ring, centerY + offset, location, mode, skip, best);
+            probeCell(centerX + ring, centerY + offset, location, mode, skip, best);
+        }
+        probed += static_cast<size_t>(8 * ring);
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Point.hpp"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ariel
+{
+    class Character;
+
+    // Default edge length of a grid cell (close to the speed of the ninjas)
+    const double GRID_CELL_SIZE = 16;
+
+    // How the distances of the candidates of a nearest query are compared
+    enum class DistanceMode : unsigned char
+    {
+        // Distances truncated to int, as the original Team::CloseCharacter did (the default)
+        Truncated,
+
+        // Exact squared distances, no sqrt at all
+        Squared
+    };
+
+    // Uniform grid over the locations of the living members of a team.
+    // Every entry remembers the slot of the character in its team, so that
+    // nearest-neighbour queries resolve ties exactly like a scan in slot order.
+    class SpatialGrid
+    {
+    public:
+        // Constructor with the edge length of a cell
+        SpatialGrid(double cellSize = GRID_CELL_SIZE);
+
+        // Index returned by nearestSlot() when the grid is empty
+        static const unsigned int NO_SLOT = ~0U;
+
+        // Register a character at its current location
+        void insert(Character *character, unsigned int slot);
+
+        // Register a character at the given location
+        void insert(Character *character, unsigned int slot, const Point &location);
+
+        // Remove a character that is registered at the given location
+        void remove(Character *character, const Point &location);
+
+        // Update the cell of a character that moved
+        void move(Character *character, const Point &from, const Point &to);
+
+        // Find the registered character closest to the origin (by default distances are truncated to int,
+        // the first slot wins on ties). Returns nullptr when the grid is empty.
+        Character *nearest(const Character *origin, DistanceMode mode = DistanceMode::Truncated) const;
+
+        // Same search from a location, returning the slot of the closest character (NO_SLOT when empty)
+        unsigned int nearestSlot(const Point &origin, DistanceMode mode = DistanceMode::Truncated) const;
+
+        // Same search ignoring the slots in [skipBegin, skipEnd), e.g. the members of one team in a grid
+        // shared by several teams (NO_SLOT when no other character is registered)
+        unsigned int nearestSlotOutside(const Point &origin, unsigned int skipBegin, unsigned int skipEnd,
+                                        DistanceMode mode = DistanceMode::Truncated) const;
+
+        // Number of registered characters
+        unsigned int size() const;
+
+        // Remove all the characters
+        void clear();
+
+    private:
+        // Members of a cell sorted by slot, with their coordinates in contiguous arrays
+        struct Cell
+        {
+            std::vector<Character *> characters;
+            std::vector<unsigned int> slots;
+            std::vector<double> xs, ys;
+
+            std::size_t find(const Character *character) const;
+            void erase(std::size_t index);
+        };
+
+        struct Candidate
+        {
+            Character *character = nullptr;
+            unsigned int slot = 0;
+
+            // Truncated distance or squared distance, depending on the mode of the search
+            int distance = 0;
+            double squared = 0;
+        };
+
+        // Slots left out of a search
+        struct SlotRange
+        {
+            unsigned int begin = 0;
+            unsigned int end = 0;
+        };
+
+        using CellKey = std::uint64_t;
+
+        double cellSize;
+        std::unordered_map<CellKey, Cell> cells;
+        unsigned int entries = 0;
+        unsigned int farEntries = 0;
+
+        bool outOfRange(const Point &point) const;
+        std::int64_t cellCoordinate(double value) const;
+        CellKey keyOf(const Point &point) const;
+        static CellKey makeKey(std::int64_t cellX, std::int64_t cellY);
+        static void scanCell(const Cell &cell, const Point &origin, DistanceMode mode, const SlotRange &skip, Candidate &best);
+        static void scanRange(const Cell &cell, std::size_t begin, std::size_t end, const Point &origin, DistanceMode mode, Candidate &best);
+        static bool outOfReach(double gapSquared, const Candidate &best, DistanceMode mode);
+        void probeCell(std::int64_t cellX, std::int64_t cellY, const Point &origin, DistanceMode mode, const SlotRange &skip, Candidate &best) const;
+        Candidate scanAll(const Point &origin, DistanceMode mode, const SlotRange &skip) const;
+        Candidate search(const Point &location, DistanceMode mode, const SlotRange &skip) const;
+    };
+}
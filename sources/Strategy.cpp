@@ -0,0 +1,34 @@
+#include "Strategy.hpp"
+#include "Team.hpp"
+#include <stdexcept>
+
+using namespace ariel;
+using namespace std;
+
+const char *ariel::strategyName(Strategy strategy)
+{
+    switch (strategy)
+    {
+    case Strategy::Team:
+        return "Team";
+    case Strategy::Team2:
+        return "Team2";
+    case Strategy::SmartTeam:
+        return "SmartTeam";
+    }
+    throw invalid_argument("Unknown strategy");
+}
+
+unique_ptr<Team> ariel::makeTeam(Strategy strategy, Character *leader, unsigned int capacity)
+{
+    switch (strategy)
+    {
+    case Strategy::Team:
+        return make_unique<Team>(leader, capacity);
+    case Strategy::Team2:
+        return make_unique<Team2>(leader, capacity);
+    case Strategy::SmartTeam:
+        return make_unique<SmartTeam>(leader, capacity);
+    }
+    throw invalid_argument("Unknown strategy");
+}
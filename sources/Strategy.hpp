@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+
+namespace ariel
+{
+    class Character;
+    class Team;
+
+    // Attack strategies that can take part in a tournament
+    enum class Strategy : unsigned char
+    {
+        Team,
+        Team2,
+        SmartTeam
+    };
+
+    const unsigned int STRATEGY_COUNT = 3;
+
+    // Get the class name of a strategy
+    const char *strategyName(Strategy strategy);
+
+    // Build an empty team of the given strategy around its leader
+    std::unique_ptr<Team> makeTeam(Strategy strategy, Character *leader, unsigned int capacity);
+}
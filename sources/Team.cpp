@@ -1,13 +1,27 @@
 #include "Team.hpp"
+#include "TextFormat.hpp"
+#include "BattleLog.hpp"
+#include "ScenarioFile.hpp"
+#include "UnitTraits.hpp"
+#include "BattleCounters.hpp"
+#include "Trace.hpp"
 #include <iostream>
+#include <algorithm>
+#include <atomic>
 #include <climits>
 #include <stdexcept>
 
 using namespace ariel;
 using namespace std;
 
+namespace
+{
+    // Room for any kind of member in the arena of a team
+    const size_t LARGEST_CHARACTER = max({sizeof(Cowboy), sizeof(YoungNinja), sizeof(TrainedNinja), sizeof(OldNinja)});
+}
+
 // Constructor
-Team::Team(Character *leader)
+Team::Team(Character *leader, unsigned int capacity) : Team(capacity)
 {
     if (leader->isLeader())
     {
@@ -18,28 +32,119 @@ Team::Team(Character *leader)
     this->leader = leader;
     add(leader);
 };
-// Destructor
-Team::~Team()
+Team::Team(unsigned int capacity)
 {
+    validateCapacity(capacity);
+    characters.assign(capacity, nullptr);
+    arena.setBlockSize(capacity * LARGEST_CHARACTER);
+}
 
-    for (unsigned int i = 0; i < TEAM_SIZE; i++)
+void Team::validateCapacity(unsigned int capacity)
+{
+    if (capacity == 0)
     {
-        delete characters[i];
-        characters[i] = NULL;
+        throw std::invalid_argument("Team capacity must be positive");
     }
-    leader = NULL;
+}
+
+Team::Team(Team &&other) noexcept
+{
+    takeMembers(other);
+}
+
+Team &Team::operator=(Team &&other) noexcept
+{
+    if (this != &other)
+    {
+        releaseCharacters();
+        takeMembers(other);
+    }
+    return *this;
+}
+
+void Team::takeMembers(Team &other) noexcept
+{
+    characters = std::move(other.characters);
+    count = std::exchange(other.count, 0);
+    leader = std::exchange(other.leader, nullptr);
+    cowboyCount = std::exchange(other.cowboyCount, 0);
+    log = std::exchange(other.log, nullptr);
+    logTeam = other.logTeam;
+    arena = std::move(other.arena);
+    grid = std::move(other.grid);
+    targeting = other.targeting;
+    slots = std::move(other.slots);
+    healthHeap = std::move(other.healthHeap);
+    relay = std::exchange(other.relay, nullptr);
+    // The moved-from team gets a new id, so caches keyed on the old one follow the members
+    teamId = std::exchange(other.teamId, nextTeamId());
+    layout = other.layout;
+    aliveCount = std::exchange(other.aliveCount, 0);
+    aliveMask = std::move(other.aliveMask);
+
+    other.characters.clear();
+    other.grid.clear();
+    other.slots.clear();
+    other.aliveMask.clear();
+    other.layout++;
+
+    // The members still report to the moved-from team until they are told otherwise
+    for (Character *character : characters)
+    {
+        if (character != nullptr)
+        {
+            character->setObserver(this);
+        }
+    }
+}
+
+// Destructor
+Team::~Team()
+{
+    releaseCharacters();
 };
 
 SmartTeam::~SmartTeam()
 {
-    for (unsigned int i = 0; i < TEAM_SIZE; i++)
+    releaseCharacters();
+};
+
+void Team::releaseCharacters()
+{
+    for (Character *&character : characters)
     {
-        delete characters[i];
-        characters[i] = NULL;
+        if (character != NULL)
+        {
+            // The member leaves the team
+            character->setObserver(nullptr);
+        }
+        if (character != NULL && arena.owns(character))
+        {
+            character->~Character();
+        }
+        else
+        {
+            delete character;
+        }
+        character = NULL;
     }
-
+    arena.release();
+    slots.clear();
+    grid.clear();
+    aliveCount = 0;
+    aliveMask.clear();
     leader = NULL;
-};
+}
+
+unsigned int Team::capacity() const
+{
+    return static_cast<unsigned int>(characters.size());
+}
+
+unsigned int Team::ninjaSlot(unsigned int ninja) const
+{
+    return capacity() - 1 - ninja;
+}
 
 void Team::add(Character *newCharacter)
 {
@@ -47,13 +152,38 @@ void Team::add(Character *newCharacter)
     validateCharacterNotInTeam(newCharacter);
     validateCharacterNotAddedToOtherTeam(newCharacter);
     allowCharacterInTeam(newCharacter);
-    addCharacterToTeam(newCharacter);
+    placeMember(newCharacter);
+}
+
+void Team::placeMember(Character *character)
+{
+    addCharacterToTeam(character);
     incrementCount();
 }
 
+void Team::load(const ScenarioRecord *records, size_t count)
+{
+    if (count > capacity() - this->count)
+    {
+        throw std::runtime_error("\033[1;31mError:\033[0m There is no place in the team");
+    }
+    slots.reserve(this->count + count);
+    for (size_t i = 0; i < count; i++)
+    {
+        Character *member = buildMember(records[i]);
+        allowCharacterInTeam(member);
+        placeMember(member);
+    }
+}
+
+Character *Team::buildMember(const ScenarioRecord &record)
+{
+    return makeCharacter(record, arena.allocate(characterSize(record), alignof(Character)));
+}
+
 void Team::validateTeamSize()
 {
-    if (count == TEAM_SIZE)
+    if (count == capacity())
     {
         throw std::runtime_error("\033[1;31mError:\033[0m There is no place in the team");
     }
@@ -82,16 +212,16 @@ void Team::allowCharacterInTeam(Character *character)
 
 void Team::addCharacterToTeam(Character *newCharacter)
 {
-    Cowboy *c = dynamic_cast<Cowboy *>(newCharacter);
-    Ninja *n = dynamic_cast<Ninja *>(newCharacter);
-
-    if (c != nullptr && cowboyCount < TEAM_SIZE) // Cowboy
+    if (newCharacter->isCowboy())
     {
+        registerCharacter(newCharacter, cowboyCount);
         characters[cowboyCount++] = newCharacter;
     }
-    else if (n != nullptr && (TEAM_SIZE - 1 - (count - cowboyCount)) >= 0) // Ninja
+    else if (newCharacter->isNinja())
     {
-        characters[TEAM_SIZE - 1 - (count - cowboyCount)] = newCharacter;
+        unsigned int slot = ninjaSlot(count - cowboyCount);
+        registerCharacter(newCharacter, slot);
+        characters[slot] = newCharacter;
     }
     else
     {
@@ -99,87 +229,430 @@ void Team::addCharacterToTeam(Character *newCharacter)
     }
 }
 
-void Team::incrementCount()
+void Team::setLog(BattleLog *log)
 {
-    count++;
+    this->log = log;
+    if (log == nullptr)
+    {
+        return;
+    }
+    logTeam = log->addTeam();
+    for (unsigned int slot = 0; slot < capacity(); slot++)
+    {
+        if (characters[slot] != nullptr)
+        {
+            logJoin(characters[slot], slot);
+        }
+    }
 }
 
-bool Team::inTeam(Character *character)
+std::uint32_t Team::unitId(const Character *member) const
 {
-    for (unsigned int i = 0; i < count; i++)
+    auto found = slots.find(const_cast<Character *>(member));
+    if (found == slots.end())
     {
-        if (characters[i] == character)
+        throw std::invalid_argument("Character is not in the team");
+    }
+    return makeUnitId(logTeam, found->second);
+}
+
+void Team::logJoin(Character *character, unsigned int slot)
+{
+    if (log != nullptr)
+    {
+        int bullets = character->isCowboy() ? static_cast<Cowboy *>(character)->whatBullets() : 0;
+        log->record(ActionKind::Join, makeUnitId(logTeam, slot), static_cast<std::uint32_t>(character->whatHealth()),
+                    static_cast<int>(character->whatKind()), static_cast<std::uint8_t>(bullets), character->getLocation());
+    }
+}
+
+void Team::logAttack(Team *enemies)
+{
+    if (log != nullptr)
+    {
+        // The ids of the targets only mean something in the log of their own team
+        if (enemies->log != log)
         {
-            return true;
+            throw std::invalid_argument("Both teams must record to the same battle log");
         }
+        log->beginAttack(logTeam);
     }
-    return false;
 }
 
-int Team::stillAlive() const
+void Team::memberShoots(Cowboy *cowboy, Character *target, Team *targets)
+{
+    int health = target->whatHealth();
+    cowboy->performShootAction(target);
+    if (log != nullptr)
+    {
+        log->record(ActionKind::Shoot, unitId(cowboy), targets->unitId(target), health - target->whatHealth(), 0, cowboy->getLocation());
+    }
+}
+
+void Team::memberReloads(Cowboy *cowboy)
+{
+    cowboy->performReload();
+    if (log != nullptr)
+    {
+        log->record(ActionKind::Reload, unitId(cowboy), 0, 0, static_cast<std::uint8_t>(cowboy->whatBullets()), cowboy->getLocation());
+    }
+}
+
+void Team::memberSlashes(Ninja *ninja, Character *target, Team *targets, int damage)
+{
+    int health = target->whatHealth();
+    ninja->performSlash(target, damage);
+    if (log != nullptr)
+    {
+        log->record(ActionKind::Slash, unitId(ninja), targets->unitId(target), health - target->whatHealth(), 0, ninja->getLocation());
+    }
+}
+
+void Team::memberMoves(Ninja *ninja, Character *target, double distance)
 {
-    int alive = 0;
-    for (unsigned int i = 0; i < TEAM_SIZE; i++)
+    ninja->performMove(target, distance);
+    if (log != nullptr)
     {
-        if (characters[i] && characters[i]->isAlive())
+        log->record(ActionKind::Move, unitId(ninja), 0, 0, 0, ninja->getLocation());
+    }
+}
+
+template <CharacterKind Kind>
+void Team::attackKernel(Character *member, Character *target, Team *targets)
+{
+    constexpr UnitTraits traits = unitTraits(Kind);
+    if constexpr (Kind == CharacterKind::Cowboy)
+    {
+        Cowboy *cowboy = static_cast<Cowboy *>(member);
+        if (cowboy->hasboolets())
         {
-            alive++;
+            memberShoots(cowboy, target, targets);
+        }
+        else
+        {
+            memberReloads(cowboy);
         }
     }
-    return alive;
+    else
+    {
+        Ninja *ninja = static_cast<Ninja *>(member);
+        if (ninja->inSlashRange(target))
+        {
+            // The cowboys may have killed the target the ninjas were given
+            if (target->isAlive())
+            {
+                memberSlashes(ninja, target, targets, traits.damage);
+            }
+        }
+        else if constexpr (Kind == CharacterKind::Ninja)
+        {
+            // Plain ninjas get their speed from their constructor
+            memberMoves(ninja, target, ninja->speed);
+        }
+        else
+        {
+            memberMoves(ninja, target, traits.speed);
+        }
+    }
+}
+
+void Team::memberAttacks(Character *member, Character *target, Team *targets)
+{
+    countEvent(BattleCounter::KindDispatches);
+    switch (member->whatKind())
+    {
+    case CharacterKind::Cowboy:
+        attackKernel<CharacterKind::Cowboy>(member, target, targets);
+        break;
+    case CharacterKind::YoungNinja:
+        attackKernel<CharacterKind::YoungNinja>(member, target, targets);
+        break;
+    case CharacterKind::TrainedNinja:
+        attackKernel<CharacterKind::TrainedNinja>(member, target, targets);
+        break;
+    case CharacterKind::OldNinja:
+        attackKernel<CharacterKind::OldNinja>(member, target, targets);
+        break;
+    case CharacterKind::Ninja:
+        attackKernel<CharacterKind::Ninja>(member, target, targets);
+        break;
+    default:
+        break;
+    }
+}
+
+void Team::registerCharacter(Character *character, unsigned int slot)
+{
+    slots[character] = slot;
+    character->setObserver(this);
+    logJoin(character, slot);
+    if (character->isAlive())
+    {
+        grid.insert(character, slot);
+        if (aliveMask.size() <= slot / 64)
+        {
+            aliveMask.resize(slot / 64 + 1, 0);
+        }
+        aliveMask[slot / 64] |= std::uint64_t{1} << (slot % 64);
+        aliveCount++;
+        layout++;
+        if (healthHeap != nullptr)
+        {
+            healthHeap->update(slot, character->whatHealth());
+        }
+        if (relay != nullptr)
+        {
+            relay->characterJoined(character, slot);
+        }
+    }
+}
+
+void Team::characterMoved(Character *character, const Point &from)
+{
+    grid.move(character, from, character->getLocation());
+    layout++;
+    if (relay != nullptr)
+    {
+        relay->characterMoved(character, from);
+    }
+}
+
+void Team::characterHit(Character *character)
+{
+    if (healthHeap != nullptr)
+    {
+        auto found = slots.find(character);
+        if (found != slots.end())
+        {
+            healthHeap->update(found->second, character->whatHealth());
+        }
+    }
+    if (relay != nullptr)
+    {
+        relay->characterHit(character);
+    }
+}
+
+void Team::characterDied(Character *character)
+{
+    grid.remove(character, character->getLocation());
+    layout++;
+    auto found = slots.find(character);
+    if (found != slots.end())
+    {
+        unsigned int slot = found->second;
+        aliveMask[slot / 64] &= ~(std::uint64_t{1} << (slot % 64));
+        aliveCount--;
+        if (healthHeap != nullptr)
+        {
+            healthHeap->remove(slot);
+        }
+    }
+    if (relay != nullptr)
+    {
+        relay->characterDied(character);
+    }
+}
+
+void Team::setObserver(CharacterObserver *observer)
+{
+    relay = observer;
+}
+
+CharacterObserver *Team::observer() const
+{
+    return relay;
+}
+
+Character *Team::weakestMember()
+{
+    if (healthHeap == nullptr)
+    {
+        healthHeap = std::make_unique<HealthHeap>();
+        for (unsigned int slot = nextAlive(0); slot < capacity(); slot = nextAlive(slot + 1))
+        {
+            healthHeap->update(slot, characters[slot]->whatHealth());
+        }
+    }
+    unsigned int slot = healthHeap->weakest();
+    return slot == HealthHeap::NO_SLOT ? nullptr : characters[slot];
+}
+
+std::uint64_t Team::nextTeamId()
+{
+    static std::atomic<std::uint64_t> teams{0};
+    return ++teams;
+}
+
+std::uint64_t Team::id() const
+{
+    return teamId;
+}
+
+std::uint64_t Team::layoutVersion() const
+{
+    return layout;
+}
+
+void Team::incrementCount()
+{
+    count++;
+}
+
+bool Team::inTeam(Character *character)
+{
+    return slots.find(character) != slots.end();
+}
+
+int Team::stillAlive() const
+{
+    return static_cast<int>(aliveCount);
 };
 
+bool Team::isAliveAt(unsigned int slot) const
+{
+    return slot / 64 < aliveMask.size() && (aliveMask[slot / 64] >> (slot % 64) & 1) != 0;
+}
+
+unsigned int Team::nextAlive(unsigned int slot) const
+{
+    size_t word = slot / 64;
+    if (word >= aliveMask.size())
+    {
+        return capacity();
+    }
+    // Ignore the slots before the requested one in the first word
+    std::uint64_t bits = aliveMask[word] & (~std::uint64_t{0} << (slot % 64));
+    while (bits == 0)
+    {
+        if (++word == aliveMask.size())
+        {
+            return capacity();
+        }
+        bits = aliveMask[word];
+    }
+    return static_cast<unsigned int>(word * 64) + static_cast<unsigned int>(__builtin_ctzll(bits));
+}
+
 void Team::print() const
 {
-    const int width = 35;
-    std::cout << "\033[1;34m" << std::string(width, '-') << '\n';
-    std::cout << "\033[1;32m" << std::setw(width / 2) << std::right << "Team Members" << '\n';
-    std::cout << "\033[1;34m" << std::string(width, '-') << '\n';
+    // The buffer is kept between calls, so printing every round doesn't allocate
+    static thread_local std::string buffer;
+    buffer.clear();
+    printTo(buffer);
+    std::cout.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    std::cout.flush();
+}
+
+void Team::printMemberTo(std::string &out, const Character *member, const char *rowColour, bool colour) const
+{
+    const size_t width = 35;
+    appendColour(out, rowColour, colour);
+    size_t start = out.size();
+    out += member == leader ? "LEADER" : "MEMBER";
+    padSince(out, start, width / 2);
+    appendColour(out, colour::RESET, colour);
+    member->printTo(out, colour);
+    out += '\n';
+}
+
+void Team::printTo(std::string &out, bool colour) const
+{
+    const size_t width = 35;
+    appendColour(out, colour::BLUE, colour);
+    appendRepeated(out, '-', width);
+    out += '\n';
+    appendColour(out, colour::GREEN, colour);
+    size_t start = out.size();
+    out += "Team Members";
+    padSince(out, start, width / 2, false);
+    out += '\n';
+    appendColour(out, colour::BLUE, colour);
+    appendRepeated(out, '-', width);
+    out += '\n';
 
     // Cowboys
     for (unsigned int i = 0; i < cowboyCount; i++)
     {
         if (characters[i])
         {
-            std::cout << "\033[1;35m" << std::left << std::setw(width / 2) << (characters[i] == leader ? "LEADER" : "MEMBER")
-                      << "\033[0m" << characters[i]->print() << '\n';
+            printMemberTo(out, characters[i], colour::MAGENTA, colour);
         }
     }
     // Ninjas
     unsigned int ninjaCount = count - cowboyCount;
-    for (unsigned int i = TEAM_SIZE - 1; i >= TEAM_SIZE - ninjaCount && i < TEAM_SIZE; i--)
+    for (unsigned int ninja = 0; ninja < ninjaCount; ninja++)
     {
+        unsigned int i = ninjaSlot(ninja);
         if (characters[i])
         {
-            std::cout << "\033[1;36m" << std::left << std::setw(width / 2) << (characters[i] == leader ? "LEADER" : "MEMBER")
-                      << "\033[0m" << characters[i]->print() << '\n';
+            printMemberTo(out, characters[i], colour::CYAN, colour);
         }
     }
-    std::cout << "\033[1;34m" << std::string(width, '-') << "\033[0m" << '\n';
+    appendColour(out, colour::BLUE, colour);
+    appendRepeated(out, '-', width);
+    appendColour(out, colour::RESET, colour);
+    out += '\n';
 }
 
 void Team::newLeader()
 {
+    countEvent(BattleCounter::LeaderChanges);
     leader = CloseCharacter(leader, this);
     leader->setLeader();
 };
 
 void Team::attack(Team *otherTeam)
 {
-    validateOtherTeamNotNull(otherTeam);
-    validateNotAttackingItself(otherTeam);
-    validateSelfNotEmpty();
-    validateOtherTeamNotEmpty(otherTeam);
+    TraceScope trace("Team::attack");
+    {
+        TraceScope phase("validation");
+        validateOtherTeamNotNull(otherTeam);
+        validateNotAttackingItself(otherTeam);
+        validateSelfNotEmpty();
+        validateOtherTeamNotEmpty(otherTeam);
+    }
 
+    logAttack(otherTeam);
     ensureLeaderIsAlive();
-    Character *target = findClosestTarget(otherTeam);
+    Character *target = nullptr;
+    {
+        TraceScope phase("target selection");
+        target = findClosestTarget(otherTeam);
+    }
     if (!target)
         return;
 
-    performCowboyAttacks(target, otherTeam);
+    {
+        TraceScope phase("cowboys");
+        performCowboyAttacks(target, otherTeam);
+    }
+    TraceScope phase("ninjas");
     performNinjaAttacks(target, otherTeam);
 }
 
+ActionError Team::tryAttack(Team *enemies)
+{
+    if (enemies == nullptr)
+    {
+        return ActionError::NullTarget;
+    }
+    if (this == enemies)
+    {
+        return ActionError::SelfTarget;
+    }
+    if (stillAlive() == 0)
+    {
+        return ActionError::DeadActor;
+    }
+    if (enemies->stillAlive() == 0)
+    {
+        return ActionError::DeadTarget;
+    }
+    attack(enemies);
+    return ActionError::None;
+}
+
 void Team::validateOtherTeamNotNull(Team *otherTeam)
 {
     if (otherTeam == nullptr)
@@ -216,6 +689,7 @@ void Team::ensureLeaderIsAlive()
 {
     if (!leader->isAlive())
     {
+        TraceScope phase("leader");
         newLeader();
     }
 }
@@ -231,15 +705,8 @@ void Team::performCowboyAttacks(Character *target, Team *otherTeam)
     {
         if (characters[i]->isAlive())
         {
-            Cowboy *cowboy = dynamic_cast<Cowboy *>(characters[i]);
-            if (cowboy != nullptr && cowboy->hasboolets())
-            {
-                cowboy->shoot(target);
-            }
-            else
-            {
-                cowboy->reload();
-            }
+            // Only cowboys are stored in the front slots
+            attackKernel<CharacterKind::Cowboy>(characters[i], target, otherTeam);
             target = isTarget(target, otherTeam);
             if (!target)
                 return;
@@ -249,9 +716,9 @@ void Team::performCowboyAttacks(Character *target, Team *otherTeam)
 void Team::performNinjaAttacks(Character *target, Team *otherTeam)
 {
     unsigned int ninjaCount = count - cowboyCount;
-    for (unsigned int i = TEAM_SIZE - 1; i >= TEAM_SIZE - ninjaCount; i--)
+    for (unsigned int ninja = 0; ninja < ninjaCount; ninja++)
     {
-        performNinjaAction(i, target, otherTeam);
+        performNinjaAction(ninjaSlot(ninja), target, otherTeam);
         target = isTarget(target, otherTeam);
         if (!target)
             break; // Exit the loop if no target found
@@ -262,18 +729,8 @@ void Team::performNinjaAction(unsigned int index, Character *target, Team *other
 {
     if (characters[index]->isAlive())
     {
-        Ninja *ninja = dynamic_cast<Ninja *>(characters[index]);
-        if (ninja != nullptr && ninja->distance(target) <= 1)
-        {
-            if (target->isAlive())
-            {
-                ninja->slash(target);
-            }
-        }
-        else
-        {
-            ninja->move(target);
-        }
+        // Only ninjas are stored in the back slots
+        memberAttacks(characters[index], target, otherTeam);
     }
 }
 
@@ -281,6 +738,7 @@ Character *Team::isTarget(Character *target, Team *otherTeam)
 {
     if (!target->isAlive())
     {
+        countEvent(BattleCounter::TargetSwitches);
         target = CloseCharacter(leader, otherTeam);
     }
     return target;
@@ -290,16 +748,10 @@ Character *Team::isTarget(Character *target, Team *otherTeam)
 
 Team2::~Team2()
 {
-    for (unsigned int i = 0; i < TEAM_SIZE; i++)
-    {
-        delete characters[i];
-        characters[i] = NULL;
-    }
-
-    leader = NULL;
+    releaseCharacters();
 };
 
-Team2::Team2(Character *leader)
+Team2::Team2(Character *leader, unsigned int capacity) : Team(capacity)
 {
     if (leader->isLeader())
     {
@@ -311,9 +763,15 @@ Team2::Team2(Character *leader)
     this->add(leader);
 };
 
+void Team2::placeMember(Character *character)
+{
+    registerCharacter(character, count);
+    characters[count++] = character;
+}
+
 void Team2::add(Character *newCharacter)
 {
-    if (count == TEAM_SIZE)
+    if (count == capacity())
     {
         errormsg("Team is full");
         throw runtime_error("Team is full");
@@ -329,11 +787,9 @@ void Team2::add(Character *newCharacter)
         throw runtime_error("Character is already in a team");
         return;
     }
-    Cowboy *c = dynamic_cast<Cowboy *>(newCharacter);
-    Ninja *n = dynamic_cast<Ninja *>(newCharacter);
-    if (c != NULL || n != NULL)
+    if (newCharacter->isCowboy() || newCharacter->isNinja())
     {
-        characters[count++] = newCharacter;
+        placeMember(newCharacter);
     }
     else
     {
@@ -345,32 +801,44 @@ void Team2::add(Character *newCharacter)
 
 void Team2::print() const
 {
-    std::cout << std::endl;
-    std::cout << std::string(40, '-') << std::endl;
-    std::cout << std::left << std::setw(15) << "Team Details" << std::endl;
-
     if (count == 0)
     {
         errormsg("No team members added yet.");
-        std::cout << "No team members added yet." << std::endl;
+    }
+    Team::print();
+}
+
+void Team2::printTo(std::string &out, bool colour) const
+{
+    out += '\n';
+    appendRepeated(out, '-', 40);
+    out += "\nTeam Details   \n";
+
+    if (count == 0)
+    {
+        out += "No team members added yet.\n";
     }
     else
     {
-        std::cout << std::setw(15) << "Team Members: " << std::endl;
-        // Cowboys
+        out += "Team Members:  \n";
+        // Members in insertion order
         for (unsigned int i = 0; i < count; i++)
         {
-            std::cout << std::setw(5) << i + 1 << ". ";
+            size_t start = out.size();
+            appendInt(out, i + 1);
+            padSince(out, start, 5);
+            out += ". ";
             if (characters[i] == leader)
             {
-                std::cout << "(Leader) ";
+                out += "(Leader) ";
             }
-            std::cout << characters[i]->print() << std::endl;
+            characters[i]->printTo(out, colour);
+            out += '\n';
         }
     }
 
-    std::cout << std::string(40, '-') << std::endl;
-    std::cout << std::endl;
+    appendRepeated(out, '-', 40);
+    out += "\n\n";
 }
 
 void Team2::validateAttack(Team *enemies)
@@ -421,8 +889,10 @@ Character *Team2::prepareAttack(Team *enemies)
 {
     if (!leader->isAlive())
     {
+        TraceScope phase("leader");
         newLeader();
     }
+    TraceScope phase("target selection");
     return CloseCharacter(leader, enemies); // find target that is close to the leader
 }
 
@@ -432,30 +902,7 @@ void Team2::executeAttack(Team *enemies, Character *target)
     {
         if (characters[i]->isAlive())
         {
-            Cowboy *c = dynamic_cast<Cowboy *>(characters[i]);
-            Ninja *n = dynamic_cast<Ninja *>(characters[i]);
-            if (c != NULL)
-            {
-                if (c->hasboolets())
-                {
-                    c->shoot(target);
-                }
-                else
-                {
-                    c->reload();
-                }
-            }
-            else if (n != NULL)
-            {
-                if (n->distance(target) <= 1)
-                {
-                    n->slash(target);
-                }
-                else
-                {
-                    n->move(target);
-                }
-            }
+            memberAttacks(characters[i], target, enemies);
             target = isTarget(target, enemies); // check if target is still alive or find a new target
             if (!target)
             {
@@ -467,17 +914,24 @@ void Team2::executeAttack(Team *enemies, Character *target)
 
 void Team2::attack(Team *enemies)
 {
-    validateAttack(enemies);
+    TraceScope trace("Team2::attack");
+    {
+        TraceScope phase("validation");
+        validateAttack(enemies);
+    }
+    logAttack(enemies);
     Character *target = prepareAttack(enemies);
     if (target)
     {
+        // Cowboys and ninjas act in slot order, in a single phase
+        TraceScope phase("members");
         executeAttack(enemies, target);
     }
 }
 
 // Smart Team
 
-SmartTeam::SmartTeam(Character *leader) : Team(leader){};
+SmartTeam::SmartTeam(Character *leader, unsigned int capacity) : Team(leader, capacity){};
 
 void SmartTeam::validateAttack(Team *otherTeam)
 {
@@ -505,34 +959,29 @@ void SmartTeam::validateAttack(Team *otherTeam)
 
 void SmartTeam::ninjasAttack(Team *otherTeam)
 {
+    // Stop as soon as the enemy team is wiped out, there is no one left to slash
     unsigned int ninjaCount = count - cowboyCount;
-    for (unsigned int i = 9; i > 9 - ninjaCount; i--)
+    for (unsigned int member = 0; member < ninjaCount && otherTeam->stillAlive() > 0; member++)
     {
+        unsigned int i = ninjaSlot(member);
         if (characters[i]->isAlive())
         {
-            Ninja &ninja = dynamic_cast<Ninja &>(*(characters[i]));
-            Character *closestEnemy = CloseCharacter(characters[i], otherTeam);
-            if (ninja.distance(closestEnemy) <= 1)
-            {
-                ninja.slash(closestEnemy);
-            }
-            else
-            {
-                ninja.move(closestEnemy);
-            }
+            Ninja &ninja = static_cast<Ninja &>(*(characters[i]));
+            Character *closestEnemy = nearestEnemy(member, ninja, otherTeam);
+            memberAttacks(&ninja, closestEnemy, otherTeam);
         }
     }
 }
 
 void SmartTeam::cowboysAttack(Team *otherTeam)
 {
-    for (unsigned int i = 0; i < cowboyCount; i++)
+    for (unsigned int i = 0; i < cowboyCount && otherTeam->stillAlive() > 0; i++)
     {
         if (characters[i]->isAlive())
         {
-            Cowboy &cowboy = dynamic_cast<Cowboy &>(*(characters[i]));
+            Cowboy &cowboy = static_cast<Cowboy &>(*(characters[i]));
             Character *target = findTarget(cowboy, otherTeam);
-            cowboyAction(cowboy, target);
+            cowboyAction(cowboy, target, otherTeam);
         }
     }
 }
@@ -542,78 +991,75 @@ Character *SmartTeam::findTarget(Cowboy &cowboy, Team *otherTeam)
     return findWeakestEnemy(otherTeam);
 }
 
-void SmartTeam::cowboyAction(Cowboy &cowboy, Character *target)
+void SmartTeam::cowboyAction(Cowboy &cowboy, Character *target, Team *otherTeam)
 {
-    if (cowboy.hasboolets())
+    attackKernel<CharacterKind::Cowboy>(&cowboy, target, otherTeam);
+}
+
+void SmartTeam::attack(Team *otherTeam)
+{
+    // Every member picks its own target, within the phase of its kind
+    TraceScope trace("SmartTeam::attack");
     {
-        cowboy.shoot(target);
+        TraceScope phase("validation");
+        validateAttack(otherTeam);
     }
-    else
+    logAttack(otherTeam);
     {
-        cowboy.reload();
+        TraceScope phase("ninjas");
+        ninjasAttack(otherTeam);
     }
+    TraceScope phase("cowboys");
+    cowboysAttack(otherTeam);
 }
 
-void SmartTeam::attack(Team *otherTeam)
+Character *Team::CloseCharacter(Character *character, Team *team)
 {
-    validateAttack(otherTeam);
-    ninjasAttack(otherTeam);
-    cowboysAttack(otherTeam);
+    countEvent(BattleCounter::NearestQueries);
+    // The grid only holds living members and breaks ties in slot order
+    return team->grid.nearest(character, targeting);
 }
 
-Character *Team::CloseCharacter(Character *character, Team *team)
+void Team::setDistanceMode(DistanceMode mode)
 {
-    Character *closest = NULL;
-    int minDistance = INT_MAX;
-    for (unsigned int i = 0; i < TEAM_SIZE; i++)
-    {
-        if (team->characters[i] && team->characters[i]->isAlive())
-        {
-            int distance = character->distance(team->characters[i]);
-            if (distance < minDistance)
-            {
-                minDistance = distance;
-                closest = team->characters[i];
-            }
-        }
-    }
-    return closest;
+    targeting = mode;
 }
 
-int SmartTeam::findMinHealthEnemy(Team *otherTeam)
+DistanceMode Team::distanceMode() const
 {
-    int minHealth = INT_MAX;
-    for (unsigned int i = 0; i < TEAM_SIZE; i++)
-    {
-        if (otherTeam->characters[i] && otherTeam->characters[i]->isAlive())
-        {
-            int health = otherTeam->characters[i]->whatHealth();
-            if (health < minHealth)
-            {
-                minHealth = health;
-            }
-        }
-    }
-    return minHealth;
+    return targeting;
 }
 
 Character *SmartTeam::findWeakestEnemy(Team *otherTeam)
 {
-    int minHealth = findMinHealthEnemy(otherTeam);
-    Character *weakestEnemy = NULL;
-    for (unsigned int i = 0; i < TEAM_SIZE; i++)
+    // The enemy team keeps its members in a health heap, no scan per cowboy
+    return otherTeam->weakestMember();
+}
+
+Character *SmartTeam::nearestEnemy(unsigned int member, Ninja &ninja, Team *otherTeam)
+{
+    if (nearestEnemies.size() <= member)
     {
-        if (otherTeam->characters[i] && otherTeam->characters[i]->isAlive() && otherTeam->characters[i]->whatHealth() == minHealth)
-        {
-            weakestEnemy = otherTeam->characters[i];
-            break;
-        }
+        nearestEnemies.resize(count - cowboyCount);
+    }
+    NearestEnemy &cached = nearestEnemies[member];
+    Point from = ninja.getLocation();
+    if (cached.enemy != nullptr && cached.team == otherTeam->id() && cached.version == otherTeam->layoutVersion() &&
+        cached.mode == distanceMode() && cached.from.whatX() == from.whatX() && cached.from.whatY() == from.whatY())
+    {
+        countEvent(BattleCounter::NearestCacheHits);
+        return cached.enemy;
     }
-    return weakestEnemy;
+    cached.team = otherTeam->id();
+    cached.version = otherTeam->layoutVersion();
+    cached.mode = distanceMode();
+    cached.from = from;
+    cached.enemy = CloseCharacter(&ninja, otherTeam);
+    return cached.enemy;
 }
 
 // error handling
 void Team::errormsg(std::string msg) const
 {
-    std::cerr << "Error: " << msg << std::endl;
+    std::cerr << "Error: " << msg << '\n';
 }
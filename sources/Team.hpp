@@ -1,36 +1,49 @@
 #pragma once
 
 #include "Character.hpp"
-#include <array>
+#include "SpatialGrid.hpp"
+#include "CharacterArena.hpp"
+#include "HealthHeap.hpp"
 #include <stdexcept>
 #include <iomanip>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace ariel
 {
+    class BattleLog;
+    struct ScenarioRecord;
+
+    // Default number of members in a team
     const unsigned int TEAM_SIZE = 10;
 
-    class Team
+    class Team : public CharacterObserver
     {
     public:
         // Constructors and destructor
 
-        // Constructor with leader character
-        Team(Character *leader);
+        // Constructor with leader character and the maximal number of members
+        Team(Character *leader, unsigned int capacity = TEAM_SIZE);
 
         // Default constructor
         Team() = default;
 
-        // Copy constructor
-        Team(const Team &) = default;
+        // Copy constructor (a team owns its members, so it can't be copied)
+        Team(const Team &) = delete;
 
         // Copy assignment operator
-        Team &operator=(const Team &) = default;
+        Team &operator=(const Team &) = delete;
 
-        // Move constructor
-        Team(Team &&) noexcept = default;
+        // Move constructor (the members report to the new team from then on, the moved-from team is empty)
+        Team(Team &&other) noexcept;
 
-        // Move assignment operator
-        Team &operator=(Team &&) noexcept = default;
+        // Move assignment operator (the members of this team are deleted first)
+        Team &operator=(Team &&other) noexcept;
 
         // Virtual destructor
         virtual ~Team();
@@ -46,25 +59,88 @@ namespace ariel
         // Check if a character is a target in the enemy team
         Character *isTarget(Character *target, Team *otherTeam);
 
-        // Find the closest character to a given character in a team
+        // Find the closest character to a given character in a team (compared with the distance mode of this team)
         Character *CloseCharacter(Character *character, Team *team);
 
+        // Choose how the team compares distances when it picks targets and new leaders
+        void setDistanceMode(DistanceMode mode);
+
+        // Get the distance mode of the team (Truncated unless changed)
+        DistanceMode distanceMode() const;
+
         // Add a character to the team
         virtual void add(Character *character);
 
+        // Build a character in the memory of the team and add it (the team owns it like any other member)
+        template <typename T, typename... Args>
+        T *emplace(Args &&...args);
+
+        // Build the units of a validated scenario file in the memory of the team. Only the room
+        // in the team is checked, once: the units are new characters of a known kind.
+        void load(const ScenarioRecord *records, std::size_t count);
+
         // Perform an attack on the enemy team
         virtual void attack(Team *enemies);
 
-        // Get the number of characters still alive in the team
+        // Perform an attack without exceptions or error output: the teams are checked once, up front,
+        // and the reason is returned when the attack isn't allowed
+        [[nodiscard]] ActionError tryAttack(Team *enemies);
+
+        // Get the number of characters still alive in the team (constant time)
         int stillAlive() const;
 
-        // Print the team's information
+        // Check if the member in the given slot is alive
+        bool isAliveAt(unsigned int slot) const;
+
+        // Get the first slot from the given one that holds a living member (capacity() if there is none)
+        unsigned int nextAlive(unsigned int slot) const;
+
+        // Get the maximal number of members in the team
+        unsigned int capacity() const;
+
+        // Get the living member with the least health, the first slot wins on ties (nullptr when all are dead).
+        // The health heap is built on the first call and kept up to date from then on.
+        Character *weakestMember();
+
+        // Id of the team, unique in the process
+        std::uint64_t id() const;
+
+        // Changes every time a member joins, moves or dies: while it stays the same, so do the closest members
+        std::uint64_t layoutVersion() const;
+
+        // Record the members and every action of the team in a battle log (nullptr stops recording).
+        // The teams it attacks must record to the same log, otherwise attack() throws.
+        void setLog(BattleLog *log);
+
+        // Get the id of a member in the battle log of the team
+        std::uint32_t unitId(const Character *member) const;
+
+        // Print the team's information (in a single write)
         virtual void print() const;
 
+        // Append the team's information to a buffer (without colour codes if colour is false)
+        virtual void printTo(std::string &out, bool colour = true) const;
+
+        // Pass the notifications of the members on to another observer as well, including the members
+        // that join from then on (nullptr stops)
+        void setObserver(CharacterObserver *observer);
+
+        // Get the observer the notifications are passed on to
+        CharacterObserver *observer() const;
+
+        // Keep the spatial index up to date when a member moves
+        void characterMoved(Character *character, const Point &from) override;
+
+        // Keep the health heap up to date when a member is hit
+        void characterHit(Character *character) override;
+
+        // Drop a member from the spatial index when it dies
+        void characterDied(Character *character) override;
+
         // Data members
 
-        // Array of characters in the team
-        std::array<Character *, TEAM_SIZE> characters = {nullptr};
+        // Slots of the team: cowboys from the front, ninjas from the back
+        std::vector<Character *> characters = std::vector<Character *>(TEAM_SIZE, nullptr);
 
         // Number of characters in the team
         unsigned int count = 0;
@@ -77,13 +153,88 @@ namespace ariel
 
         void errormsg(std::string msg) const;
 
+    protected:
+        // Constructor of an empty team with the given capacity (used by teams with their own add())
+        explicit Team(unsigned int capacity);
+
+        // Start tracking a member that was placed in the given slot
+        void registerCharacter(Character *character, unsigned int slot);
+
+        // Put a validated member in its slot
+        virtual void placeMember(Character *character);
+
+        // Slot of the n-th ninja (ninjas are stored from the back)
+        unsigned int ninjaSlot(unsigned int ninja) const;
+
+        // Delete all the members
+        void releaseCharacters();
+
+        // Take over the members and the state of a team that is moved into this one
+        void takeMembers(Team &other) noexcept;
+
+        // Start a round in the battle log (throws when the enemies record to another log or none)
+        void logAttack(Team *enemies);
+
+        // Actions of the members, recorded in the battle log when there is one. The attack loops only pass
+        // living members and living enemies, so the checks of the public actions are skipped.
+        void memberShoots(Cowboy *cowboy, Character *target, Team *targets);
+        void memberReloads(Cowboy *cowboy);
+        void memberSlashes(Ninja *ninja, Character *target, Team *targets, int damage);
+        void memberMoves(Ninja *ninja, Character *target, double distance);
+
+        // One turn of a living member of the given kind: cowboys shoot or reload, ninjas slash or move
+        // (nothing when the target in range is dead). Instantiated per kind, so its damage and speed are
+        // compile-time constants.
+        template <CharacterKind Kind>
+        void attackKernel(Character *member, Character *target, Team *targets);
+
+        // Run the attack kernel of the kind of a member
+        void memberAttacks(Character *member, Character *target, Team *targets);
+
+        // Append the row of a member to the output of print()
+        void printMemberTo(std::string &out, const Character *member, const char *rowColour, bool colour) const;
+
     private:
+        // Battle log of the team and the id of the team in it
+        BattleLog *log = nullptr;
+        std::uint8_t logTeam = 0;
+
+        void logJoin(Character *character, unsigned int slot);
+
+        // Memory of the members built by emplace()
+        CharacterArena arena;
+
+        // Living members indexed by location, used for the closest character queries
+        SpatialGrid grid;
+        DistanceMode targeting = DistanceMode::Truncated;
+
+        // Slot of every member, for constant time membership checks
+        std::unordered_map<Character *, unsigned int> slots;
+
+        // Living members by health, created by the first weakestMember() query
+        std::unique_ptr<HealthHeap> healthHeap;
+
+        // Observer of the whole team, e.g. a battle with an index shared by several teams
+        CharacterObserver *relay = nullptr;
+
+        std::uint64_t teamId = nextTeamId();
+        std::uint64_t layout = 0;
+
+        static std::uint64_t nextTeamId();
+
+        // Number of living members and one bit per slot telling if its member is alive
+        unsigned int aliveCount = 0;
+        std::vector<std::uint64_t> aliveMask;
+
+        static void validateCapacity(unsigned int capacity);
+
         void validateTeamSize();
         void validateCharacterNotInTeam(Character *character);
         void validateCharacterNotAddedToOtherTeam(Character *character);
         void allowCharacterInTeam(Character *character);
         void addCharacterToTeam(Character *newCharacter);
         void incrementCount();
+        Character *buildMember(const ScenarioRecord &record);
         void validateOtherTeamNotNull(Team *otherTeam);
         void validateNotAttackingItself(Team *otherTeam);
         void validateSelfNotEmpty();
@@ -100,17 +251,17 @@ namespace ariel
     public:
         // Constructors and destructor
 
-        // Constructor with leader character
-        Team2(Character *leader);
+        // Constructor with leader character and the maximal number of members
+        Team2(Character *leader, unsigned int capacity = TEAM_SIZE);
 
         // Default constructor
         Team2() = default;
 
         // Copy constructor
-        Team2(const Team2 &) = default;
+        Team2(const Team2 &) = delete;
 
         // Copy assignment operator
-        Team2 &operator=(const Team2 &) = default;
+        Team2 &operator=(const Team2 &) = delete;
 
         // Move constructor
         Team2(Team2 &&) noexcept = default;
@@ -132,6 +283,13 @@ namespace ariel
         // Print the team's information
         void print() const override;
 
+        // Append the team's information to a buffer
+        void printTo(std::string &out, bool colour = true) const override;
+
+    protected:
+        // Members are kept in insertion order
+        void placeMember(Character *character) override;
+
     private:
         // Validate the attack on the enemy team
         void validateAttack(Team *enemies);
@@ -153,17 +311,17 @@ namespace ariel
     public:
         // Constructors and destructor
 
-        // Constructor with leader character
-        SmartTeam(Character *leader);
+        // Constructor with leader character and the maximal number of members
+        SmartTeam(Character *leader, unsigned int capacity = TEAM_SIZE);
 
         // Default constructor
         SmartTeam() = default;
 
         // Copy constructor
-        SmartTeam(const SmartTeam &) = default;
+        SmartTeam(const SmartTeam &) = delete;
 
         // Copy assignment operator
-        SmartTeam &operator=(const SmartTeam &) = default;
+        SmartTeam &operator=(const SmartTeam &) = delete;
 
         // Move constructor
         SmartTeam(SmartTeam &&) noexcept = default;
@@ -194,13 +352,42 @@ namespace ariel
         // Find a suitable target for a cowboy in the enemy team
         Character *findTarget(Cowboy &cowboy, Team *otherTeam);
 
-        // Perform the action of a cowboy on a target
-        void cowboyAction(Cowboy &cowboy, Character *target);
+        // Perform the action of a cowboy on a target of the enemy team
+        void cowboyAction(Cowboy &cowboy, Character *target, Team *otherTeam);
 
     private:
-        // Helper functions
-
-        // Find the enemy character with the minimum health in the enemy team
-        int findMinHealthEnemy(Team *otherTeam);
+        // Closest enemy found for a ninja, valid while the enemy team and the ninja stay where they were
+        struct NearestEnemy
+        {
+            std::uint64_t team = 0;
+            std::uint64_t version = 0;
+            DistanceMode mode = DistanceMode::Truncated;
+            Point from;
+            Character *enemy = nullptr;
+        };
+
+        // One entry per ninja, in the order of ninjaSlot()
+        std::vector<NearestEnemy> nearestEnemies;
+
+        // Find the closest enemy of a ninja, reusing the last answer when nothing changed
+        Character *nearestEnemy(unsigned int member, Ninja &ninja, Team *otherTeam);
     };
+
+    template <typename T, typename... Args>
+    T *Team::emplace(Args &&...args)
+    {
+        static_assert(std::is_base_of<Character, T>::value, "Only characters can join a team");
+        T *character = new (arena.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        try
+        {
+            add(character);
+        }
+        catch (...)
+        {
+            // The memory stays in the arena until the team is destroyed
+            character->~T();
+            throw;
+        }
+        return character;
+    }
 }
@@ -0,0 +1,54 @@
+#include "TextFormat.hpp"
+#include <charconv>
+#include <stdexcept>
+
+using namespace std;
+
+void ariel::appendColour(string &out, const char *code, bool colour)
+{
+    if (colour)
+    {
+        out += code;
+    }
+}
+
+void ariel::appendInt(string &out, long long value)
+{
+    char digits[24];
+    to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+void ariel::appendFixed(string &out, double value, int precision)
+{
+    // The largest double has 309 digits before the point
+    char digits[320 + 64];
+    to_chars_result result = to_chars(digits, digits + sizeof(digits), value, chars_format::fixed, precision);
+    if (result.ec != errc())
+    {
+        throw invalid_argument("Precision is too large");
+    }
+    out.append(digits, result.ptr);
+}
+
+void ariel::appendRepeated(string &out, char character, size_t count)
+{
+    out.append(count, character);
+}
+
+void ariel::padSince(string &out, size_t start, size_t width, bool alignLeft)
+{
+    size_t length = out.size() - start;
+    if (length >= width)
+    {
+        return;
+    }
+    if (alignLeft)
+    {
+        out.append(width - length, ' ');
+    }
+    else
+    {
+        out.insert(start, width - length, ' ');
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace ariel
+{
+    // ANSI colour codes used by the print functions
+    namespace colour
+    {
+        const char *const RESET = "\033[0m";
+        const char *const RED = "\033[1;31m";
+        const char *const GREEN = "\033[1;32m";
+        const char *const YELLOW = "\033[1;33m";
+        const char *const BLUE = "\033[1;34m";
+        const char *const MAGENTA = "\033[1;35m";
+        const char *const CYAN = "\033[1;36m";
+    }
+
+    // Helpers appending to a reusable buffer, formatted like the iostream code they replace
+
+    // Append a colour code, or nothing when colours are disabled
+    void appendColour(std::string &out, const char *code, bool colour);
+
+    // Append an integer
+    void appendInt(std::string &out, long long value);
+
+    // Append a double with a fixed number of decimals (like std::fixed with std::setprecision, at most 64)
+    void appendFixed(std::string &out, double value, int precision);
+
+    // Append a character count times
+    void appendRepeated(std::string &out, char character, std::size_t count);
+
+    // Pad what was appended since start up to width bytes (like std::setw, left or right aligned)
+    void padSince(std::string &out, std::size_t start, std::size_t width, bool alignLeft = true);
+}
@@ -0,0 +1,139 @@
+#include "Tournament.hpp"
+#include "ScenarioGenerator.hpp"
+#include "WorkStealingPool.hpp"
+#include "Trace.hpp"
+#include <chrono>
+#include <stdexcept>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    // Every ordered pair of different strategies
+    const array<pair<Strategy, Strategy>, 6> PAIRINGS = {{{Strategy::Team, Strategy::Team2},
+                                                          {Strategy::Team2, Strategy::Team},
+                                                          {Strategy::Team, Strategy::SmartTeam},
+                                                          {Strategy::SmartTeam, Strategy::Team},
+                                                          {Strategy::Team2, Strategy::SmartTeam},
+                                                          {Strategy::SmartTeam, Strategy::Team2}}};
+
+    unique_ptr<Team> randomTeam(Strategy strategy, unsigned int size, ScenarioGenerator &generator)
+    {
+        unique_ptr<Team> team = makeTeam(strategy, generator.character(), size);
+        generator.fill(*team, size - 1);
+        return team;
+    }
+
+    void validateConfig(const TournamentConfig &config)
+    {
+        if (config.teamSize == 0)
+        {
+            throw invalid_argument("Team size must be positive");
+        }
+        if (config.maxRounds == 0)
+        {
+            throw invalid_argument("A battle needs at least one round");
+        }
+    }
+}
+
+double StrategyRecord::winRate() const
+{
+    return battles == 0 ? 0 : static_cast<double>(wins) / battles;
+}
+
+BattleResult ariel::runBattle(Strategy first, Strategy second, unsigned int teamSize, uint64_t seed, unsigned int maxRounds)
+{
+    ScenarioGenerator generator(seed);
+    unique_ptr<Team> sides[2] = {randomTeam(first, teamSize, generator), randomTeam(second, teamSize, generator)};
+
+    BattleResult result;
+    result.first = first;
+    result.second = second;
+    while (result.rounds < maxRounds && sides[0]->stillAlive() > 0 && sides[1]->stillAlive() > 0)
+    {
+        TraceScope trace("round");
+        sides[0]->attack(sides[1].get());
+        if (sides[1]->stillAlive() > 0)
+        {
+            sides[1]->attack(sides[0].get());
+        }
+        result.rounds++;
+    }
+    if (sides[1]->stillAlive() == 0)
+    {
+        result.winner = 0;
+    }
+    else if (sides[0]->stillAlive() == 0)
+    {
+        result.winner = 1;
+    }
+    return result;
+}
+
+TournamentReport ariel::runTournament(const TournamentConfig &config)
+{
+    validateConfig(config);
+
+    TournamentReport report;
+    report.battles = config.battles;
+    report.results.resize(config.battles);
+
+    WorkStealingPool pool(config.threads);
+    report.threads = pool.size();
+    auto start = chrono::steady_clock::now();
+    pool.run(config.battles, [&config, &report](size_t battle)
+             {
+                 const pair<Strategy, Strategy> &pairing = PAIRINGS[battle % PAIRINGS.size()];
+                 report.results[battle] = runBattle(pairing.first, pairing.second, config.teamSize,
+                                                    splitMix64(config.seed + battle), config.maxRounds); });
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // Gathered in battle order, so the report is the same for any number of threads
+    double rounds = 0;
+    for (const BattleResult &result : report.results)
+    {
+        StrategyRecord &first = report.records[static_cast<size_t>(result.first)];
+        StrategyRecord &second = report.records[static_cast<size_t>(result.second)];
+        first.battles++;
+        second.battles++;
+        if (result.winner == 0)
+        {
+            first.wins++;
+            second.losses++;
+        }
+        else if (result.winner == 1)
+        {
+            second.wins++;
+            first.losses++;
+        }
+        else
+        {
+            first.draws++;
+            second.draws++;
+            report.draws++;
+        }
+        rounds += result.rounds;
+    }
+    report.meanRounds = config.battles == 0 ? 0 : rounds / config.battles;
+    report.battlesPerSecond = report.seconds > 0 ? config.battles / report.seconds : 0;
+    return report;
+}
+
+void ariel::printReport(ostream &out, const TournamentReport &report)
+{
+    out << report.battles << " battles on " << report.threads << " threads in " << report.seconds << " s ("
+        << report.battlesPerSecond << " battles/s)" << endl;
+    out << "mean rounds: " << report.meanRounds << ", draws: " << report.draws << endl;
+    for (unsigned int strategy = 0; strategy < STRATEGY_COUNT; strategy++)
+    {
+        const StrategyRecord &record = report.records[strategy];
+        out << setw(10) << left << strategyName(static_cast<Strategy>(strategy)) << right
+            << " battles " << setw(8) << record.battles
+            << " wins " << setw(8) << record.wins
+            << " losses " << setw(8) << record.losses
+            << " draws " << setw(8) << record.draws
+            << " win rate " << fixed << setprecision(3) << record.winRate() << defaultfloat << endl;
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Team.hpp"
+#include "Strategy.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+namespace ariel
+{
+    struct TournamentConfig
+    {
+        unsigned int battles = 1000;
+        unsigned int teamSize = TEAM_SIZE;
+        std::uint64_t seed = 1;
+
+        // Number of threads (0 uses every core)
+        unsigned int threads = 0;
+
+        // A battle that lasts longer is a draw
+        unsigned int maxRounds = 1000;
+    };
+
+    struct BattleResult
+    {
+        Strategy first = Strategy::Team;
+        Strategy second = Strategy::Team;
+
+        // 0 or 1 for the side that won, -1 for a draw
+        int winner = -1;
+        unsigned int rounds = 0;
+    };
+
+    struct StrategyRecord
+    {
+        unsigned int battles = 0;
+        unsigned int wins = 0;
+        unsigned int losses = 0;
+        unsigned int draws = 0;
+
+        double winRate() const;
+    };
+
+    struct TournamentReport
+    {
+        unsigned int battles = 0;
+        unsigned int draws = 0;
+        unsigned int threads = 0;
+        double meanRounds = 0;
+        double seconds = 0;
+        double battlesPerSecond = 0;
+        std::array<StrategyRecord, STRATEGY_COUNT> records;
+        std::vector<BattleResult> results;
+    };
+
+    // Fight one battle between two random teams built from the seed. Each round the first
+    // team attacks, then the second one if it still stands.
+    BattleResult runBattle(Strategy first, Strategy second, unsigned int teamSize, std::uint64_t seed, unsigned int maxRounds);
+
+    // Fight the battles on every thread. Battle i pairs two different strategies (all ordered
+    // pairs in turn) and has its own seed, so the results don't depend on the number of threads.
+    TournamentReport runTournament(const TournamentConfig &config);
+
+    // Print the win rates, mean rounds and throughput of a tournament
+    void printReport(std::ostream &out, const TournamentReport &report);
+}
@@ -0,0 +1,224 @@
+#include "Trace.hpp"
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace ariel;
+using namespace std;
+
+namespace
+{
+    struct TraceEvent
+    {
+        const char *name;
+        uint64_t start;
+        uint64_t duration;
+        uint32_t thread;
+    };
+
+    // Events of one thread. Only the owner appends, publishing every event with a release store of
+    // the size, so that writeTrace() can read a chunk while its thread keeps recording.
+    struct TraceChunk
+    {
+        static const size_t CAPACITY = 1024;
+
+        array<TraceEvent, CAPACITY> events;
+        atomic<size_t> size{0};
+        atomic<TraceChunk *> next{nullptr};
+    };
+
+    struct TraceBuffer
+    {
+        TraceChunk first;
+        TraceChunk *last = &first;
+
+        // Owned by a running thread (buffers of finished threads are reused, keeping their events)
+        bool inUse = false;
+
+        // Free the chunks after the first one and forget all the events
+        void clear()
+        {
+            TraceChunk *chunk = first.next.exchange(nullptr);
+            while (chunk != nullptr)
+            {
+                TraceChunk *next = chunk->next.load();
+                delete chunk;
+                chunk = next;
+            }
+            first.size.store(0);
+            last = &first;
+        }
+    };
+
+    struct TraceRegistry
+    {
+        mutex lock;
+        vector<unique_ptr<TraceBuffer>> buffers;
+        uint32_t nextThread = 1;
+    };
+
+    TraceRegistry &registry()
+    {
+        // Never destroyed, threads may finish after the end of main
+        static TraceRegistry *instance = new TraceRegistry();
+        return *instance;
+    }
+
+    const chrono::steady_clock::time_point EPOCH = chrono::steady_clock::now();
+
+    // Buffer and trace id of the calling thread, released when the thread finishes
+    struct ThreadTrace
+    {
+        TraceBuffer *buffer = nullptr;
+        uint32_t thread = 0;
+
+        ThreadTrace()
+        {
+            TraceRegistry &shared = registry();
+            lock_guard<mutex> guard(shared.lock);
+            for (unique_ptr<TraceBuffer> &candidate : shared.buffers)
+            {
+                if (!candidate->inUse)
+                {
+                    buffer = candidate.get();
+                    break;
+                }
+            }
+            if (buffer == nullptr)
+            {
+                shared.buffers.push_back(make_unique<TraceBuffer>());
+                buffer = shared.buffers.back().get();
+            }
+            buffer->inUse = true;
+            thread = shared.nextThread++;
+        }
+
+        ThreadTrace(const ThreadTrace &) = delete;
+        ThreadTrace &operator=(const ThreadTrace &) = delete;
+        ThreadTrace(ThreadTrace &&) = delete;
+        ThreadTrace &operator=(ThreadTrace &&) = delete;
+
+        ~ThreadTrace()
+        {
+            TraceRegistry &shared = registry();
+            lock_guard<mutex> guard(shared.lock);
+            buffer->inUse = false;
+        }
+    };
+
+    void appendEvent(TraceBuffer &buffer, const TraceEvent &event)
+    {
+        TraceChunk *chunk = buffer.last;
+        size_t size = chunk->size.load(memory_order_relaxed);
+        if (size == TraceChunk::CAPACITY)
+        {
+            TraceChunk *next = new TraceChunk();
+            chunk->next.store(next, memory_order_release);
+            buffer.last = next;
+            chunk = next;
+            size = 0;
+        }
+        chunk->events[size] = event;
+        chunk->size.store(size + 1, memory_order_release);
+    }
+
+    // Microseconds with nanosecond digits, as the trace format expects
+    void writeMicroseconds(ostream &out, uint64_t nanoseconds)
+    {
+        out << nanoseconds / 1000 << '.' << setw(3) << setfill('0') << nanoseconds % 1000 << setfill(' ');
+    }
+}
+
+atomic<bool> ariel::traceRecording{false};
+
+void ariel::startTracing()
+{
+    traceRecording.store(true, memory_order_relaxed);
+}
+
+void ariel::stopTracing()
+{
+    traceRecording.store(false, memory_order_relaxed);
+}
+
+bool ariel::tracingEnabled()
+{
+    return traceRecording.load(memory_order_relaxed);
+}
+
+uint64_t ariel::traceClock()
+{
+    // Never 0, which marks the scopes that started while tracing was off
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - EPOCH).count()) + 1;
+}
+
+void ariel::recordTraceEvent(const char *name, uint64_t start, uint64_t end)
+{
+    thread_local ThreadTrace trace;
+    appendEvent(*trace.buffer, TraceEvent{name, start, end - start, trace.thread});
+}
+
+size_t ariel::traceEventCount()
+{
+    TraceRegistry &shared = registry();
+    lock_guard<mutex> guard(shared.lock);
+    size_t count = 0;
+    for (const unique_ptr<TraceBuffer> &buffer : shared.buffers)
+    {
+        for (const TraceChunk *chunk = &buffer->first; chunk != nullptr; chunk = chunk->next.load(memory_order_acquire))
+        {
+            count += chunk->size.load(memory_order_acquire);
+        }
+    }
+    return count;
+}
+
+void ariel::writeTrace(ostream &out)
+{
+    TraceRegistry &shared = registry();
+    lock_guard<mutex> guard(shared.lock);
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (const unique_ptr<TraceBuffer> &buffer : shared.buffers)
+    {
+        for (const TraceChunk *chunk = &buffer->first; chunk != nullptr; chunk = chunk->next.load(memory_order_acquire))
+        {
+            size_t size = chunk->size.load(memory_order_acquire);
+            for (size_t i = 0; i < size; i++)
+            {
+                const TraceEvent &event = chunk->events[i];
+                out << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"battle\",\"ph\":\"X\",\"ts\":";
+                writeMicroseconds(out, event.start);
+                out << ",\"dur\":";
+                writeMicroseconds(out, event.duration);
+                out << ",\"pid\":1,\"tid\":" << event.thread << "}";
+                first = false;
+            }
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void ariel::saveTrace(const string &path)
+{
+    ofstream out(path, ios::trunc);
+    writeTrace(out);
+    if (!out)
+    {
+        throw runtime_error("Can't write " + path);
+    }
+}
+
+void ariel::clearTrace()
+{
+    TraceRegistry &shared = registry();
+    lock_guard<mutex> guard(shared.lock);
+    for (unique_ptr<TraceBuffer> &buffer : shared.buffers)
+    {
+        buffer->clear();
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace ariel
+{
+    // Start and stop recording trace scopes (off by default). While tracing is off a scope costs one relaxed load.
+    void startTracing();
+    void stopTracing();
+    bool tracingEnabled();
+
+    // Number of events recorded so far by all the threads
+    std::size_t traceEventCount();
+
+    // Write the recorded events as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)
+    void writeTrace(std::ostream &out);
+    void saveTrace(const std::string &path);
+
+    // Drop the recorded events. No thread may be inside a trace scope meanwhile.
+    void clearTrace();
+
+    // Set by startTracing(), read by every trace scope
+    extern std::atomic<bool> traceRecording;
+
+    // Nanoseconds on the clock of the trace events
+    std::uint64_t traceClock();
+
+    // Append a finished scope to the buffer of the calling thread (without locks)
+    void recordTraceEvent(const char *name, std::uint64_t start, std::uint64_t end);
+
+    // Records the time between its construction and its destruction as a trace event of the calling thread.
+    // The name must outlive the trace (a string literal).
+    class TraceScope
+    {
+    public:
+        explicit TraceScope(const char *name)
+            : name(name), start(traceRecording.load(std::memory_order_relaxed) ? traceClock() : 0) {}
+
+        TraceScope(const TraceScope &) = delete;
+        TraceScope &operator=(const TraceScope &) = delete;
+        TraceScope(TraceScope &&) = delete;
+        TraceScope &operator=(TraceScope &&) = delete;
+
+        ~TraceScope()
+        {
+            if (start != 0)
+            {
+                recordTraceEvent(name, start, traceClock());
+            }
+        }
+
+    private:
+        const char *name;
+
+        // 0 when tracing was off at the start of the scope
+        std::uint64_t start;
+    };
+}
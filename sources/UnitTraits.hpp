@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Character.hpp"
+#include <limits>
+
+namespace ariel
+{
+    // Stats of a kind of unit
+    struct UnitTraits
+    {
+        // Health of a new unit
+        int health;
+
+        // Bullets of a full magazine (cowboys)
+        int bullets;
+
+        // Distance moved towards an enemy in one turn (ninjas)
+        int speed;
+
+        // Damage of one shot or slash
+        int damage;
+
+        // Largest distance to an enemy that can be hit
+        double range;
+    };
+
+    // Get the stats of a kind of unit. The health and speed of a plain Ninja are given to its
+    // constructor, so they are 0 here; kinds that can't fight have no stats at all.
+    constexpr UnitTraits unitTraits(CharacterKind kind)
+    {
+        switch (kind)
+        {
+        case CharacterKind::Cowboy:
+            return {110, 6, 0, 10, std::numeric_limits<double>::infinity()};
+        case CharacterKind::Ninja:
+            return {0, 0, 0, 40, 1};
+        case CharacterKind::YoungNinja:
+            return {100, 0, 14, 40, 1};
+        case CharacterKind::TrainedNinja:
+            return {120, 0, 12, 40, 1};
+        case CharacterKind::OldNinja:
+            return {150, 0, 8, 40, 1};
+        default:
+            return {0, 0, 0, 0, 0};
+        }
+    }
+
+    // Stats of the kinds that are used on their own
+    constexpr UnitTraits COWBOY_TRAITS = unitTraits(CharacterKind::Cowboy);
+    constexpr UnitTraits NINJA_TRAITS = unitTraits(CharacterKind::Ninja);
+
+    // Slashes are checked with Point::withinUnitDistance
+    static_assert(NINJA_TRAITS.range == 1, "Ninjas slash enemies at most 1 away");
+}
@@ -0,0 +1,177 @@
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+#include <utility>
+
+using namespace ariel;
+using namespace std;
+
+WorkStealingPool::WorkStealingPool(unsigned int threads)
+{
+    if (threads == 0)
+    {
+        threads = max(1U, thread::hardware_concurrency());
+    }
+    for (unsigned int id = 0; id < threads; id++)
+    {
+        workers.push_back(make_unique<Worker>());
+    }
+    // Worker 0 is the thread calling run()
+    for (unsigned int id = 1; id < threads; id++)
+    {
+        this->threads.emplace_back(&WorkStealingPool::workerLoop, this, id);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    started.notify_all();
+    for (thread &worker : threads)
+    {
+        worker.join();
+    }
+}
+
+unsigned int WorkStealingPool::size() const
+{
+    return static_cast<unsigned int>(workers.size());
+}
+
+void WorkStealingPool::run(size_t count, const function<void(size_t)> &task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Even shares, handed out in chunks small enough to keep every worker busy until the end
+    size_t share = count / workers.size();
+    size_t extra = count % workers.size();
+    size_t begin = 0;
+    for (size_t id = 0; id < workers.size(); id++)
+    {
+        lock_guard<mutex> guard(workers[id]->lock);
+        workers[id]->begin = begin;
+        begin += share + (id < extra ? 1 : 0);
+        workers[id]->end = begin;
+    }
+
+    {
+        lock_guard<mutex> guard(lock);
+        this->task = &task;
+        grain = max<size_t>(1, count / (workers.size() * 16));
+        error = nullptr;
+        busy = size();
+        generation++;
+    }
+    started.notify_all();
+
+    work(0);
+
+    unique_lock<mutex> guard(lock);
+    finished.wait(guard, [this]
+                  { return busy == 0; });
+    this->task = nullptr;
+    if (error)
+    {
+        rethrow_exception(exchange(error, nullptr));
+    }
+}
+
+void WorkStealingPool::workerLoop(unsigned int id)
+{
+    unsigned long seen = 0;
+    while (true)
+    {
+        {
+            unique_lock<mutex> guard(lock);
+            started.wait(guard, [this, seen]
+                         { return stopping || generation != seen; });
+            if (stopping)
+            {
+                return;
+            }
+            seen = generation;
+        }
+        work(id);
+    }
+}
+
+void WorkStealingPool::work(unsigned int id)
+{
+    size_t begin = 0;
+    size_t end = 0;
+    while (takeOwn(id, begin, end) || (steal(id) && takeOwn(id, begin, end)))
+    {
+        for (size_t index = begin; index < end; index++)
+        {
+            try
+            {
+                (*task)(index);
+            }
+            catch (...)
+            {
+                fail(current_exception());
+            }
+        }
+    }
+
+    lock_guard<mutex> guard(lock);
+    if (--busy == 0)
+    {
+        finished.notify_all();
+    }
+}
+
+bool WorkStealingPool::takeOwn(unsigned int id, size_t &begin, size_t &end)
+{
+    Worker &worker = *workers[id];
+    lock_guard<mutex> guard(worker.lock);
+    if (worker.begin == worker.end)
+    {
+        return false;
+    }
+    begin = worker.begin;
+    end = min(worker.end, begin + grain);
+    worker.begin = end;
+    return true;
+}
+
+bool WorkStealingPool::steal(unsigned int id)
+{
+    for (size_t offset = 1; offset < workers.size(); offset++)
+    {
+        Worker &victim = *workers[(id + offset) % workers.size()];
+        size_t begin = 0;
+        size_t end = 0;
+        {
+            lock_guard<mutex> guard(victim.lock);
+            if (victim.begin == victim.end)
+            {
+                continue;
+            }
+            // Take the back half, the victim keeps going from the front
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            end = victim.end;
+            victim.end = begin;
+        }
+        Worker &thief = *workers[id];
+        lock_guard<mutex> guard(thief.lock);
+        thief.begin = begin;
+        thief.end = end;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::fail(exception_ptr exception)
+{
+    lock_guard<mutex> guard(lock);
+    if (!error)
+    {
+        error = exception;
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ariel
+{
+    // Fixed set of threads running index ranges. Every worker starts with its own share
+    // of the range and steals half of the work left to another worker when it runs out.
+    class WorkStealingPool
+    {
+    public:
+        // Constructor with the number of threads (0 uses every core), the calling thread is one of them
+        explicit WorkStealingPool(unsigned int threads = 0);
+
+        WorkStealingPool(const WorkStealingPool &) = delete;
+        WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+        WorkStealingPool(WorkStealingPool &&) = delete;
+        WorkStealingPool &operator=(WorkStealingPool &&) = delete;
+
+        ~WorkStealingPool();
+
+        // Get the number of threads running the tasks
+        unsigned int size() const;
+
+        // Run task(index) for every index in [0, count) and wait for all of them.
+        // The first exception thrown by a task is thrown again once the others are done.
+        void run(std::size_t count, const std::function<void(std::size_t)> &task);
+
+    private:
+        // Range of indexes left to a worker
+        struct Worker
+        {
+            std::mutex lock;
+            std::size_t begin = 0;
+            std::size_t end = 0;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::thread> threads;
+
+        std::mutex lock;
+        std::condition_variable started;
+        std::condition_variable finished;
+        const std::function<void(std::size_t)> *task = nullptr;
+        std::size_t grain = 1;
+        unsigned long generation = 0;
+        unsigned int busy = 0;
+        bool stopping = false;
+        std::exception_ptr error;
+
+        void workerLoop(unsigned int id);
+        void work(unsigned int id);
+        bool takeOwn(unsigned int id, std::size_t &begin, std::size_t &end);
+        bool steal(unsigned int id);
+        void fail(std::exception_ptr exception);
+    };
+}